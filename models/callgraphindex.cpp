@@ -0,0 +1,260 @@
+#include "callgraphindex.h"
+#include <algorithm>
+#include <iterator>
+
+#define CALLGRAPH_MAX_CHANGES 4096 // Past this a full rebuild is cheaper than tracking single changes
+
+CallGraphIndex::CallGraphIndex(): m_built(false), m_rebuild(false) { }
+
+void CallGraphIndex::setDisassembler(const REDasm::DisassemblerPtr &disassembler)
+{
+    m_disassembler = disassembler;
+    this->clear();
+}
+
+void CallGraphIndex::invalidate(const REDasm::ListingDocumentChanged *ldc)
+{
+    bool function = ldc->item->is(REDasm::ListingItem::FunctionItem);
+
+    if(!function && !ldc->item->is(REDasm::ListingItem::InstructionItem))
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(!m_built || m_rebuild)
+        return;
+
+    if(m_changes.size() >= CALLGRAPH_MAX_CHANGES)
+    {
+        m_changes.clear();
+        m_rebuild = true;
+        return;
+    }
+
+    m_changes.append({ ldc->item->address, function });
+}
+
+bool CallGraphIndex::update()
+{
+    QVector<Change> changes;
+    bool rebuild = false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if(!m_built || m_rebuild)
+        {
+            m_changes.clear();
+            m_built = true;
+            m_rebuild = false;
+            rebuild = true;
+        }
+        else
+            changes.swap(m_changes);
+    }
+
+    if(rebuild)
+    {
+        this->build();
+        return true;
+    }
+
+    if(changes.empty())
+        return false;
+
+    auto& document = m_disassembler->document();
+    QHash<int, QVector<Call> > rescanned;
+
+    for(const Change& change : changes)
+    {
+        if(!change.function)
+        {
+            int idx = this->ownerFunction(change.address);
+
+            if(idx != -1)
+                rescanned[idx].clear();
+
+            continue;
+        }
+
+        // Changed functions keep their slot, only real removals leave a tombstone
+        auto fit = m_functionindex.find(change.address);
+        auto it = document->functionItem(change.address);
+
+        if(it != document->end())
+        {
+            if(fit != m_functionindex.end())
+            {
+                m_functions[fit.value()] = it->get(); // The item can be a new one at the same address
+                rescanned[fit.value()].clear();
+            }
+            else
+                rescanned[this->addFunction(it->get())].clear();
+        }
+        else if(fit != m_functionindex.end())
+        {
+            m_functions[fit.value()] = NULL;
+            rescanned[fit.value()].clear();
+            m_functionindex.erase(fit);
+        }
+    }
+
+    for(auto it = rescanned.begin(); it != rescanned.end(); it++)
+    {
+        if(m_functions[it.key()])
+            it.value() = this->scan(m_functions[it.key()]);
+    }
+
+    this->compact(rescanned);
+    return true;
+}
+
+void CallGraphIndex::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_functions.clear();
+    m_functionindex.clear();
+    m_calleeoffsets.clear();
+    m_calleroffsets.clear();
+    m_callees.clear();
+    m_callers.clear();
+    m_changes.clear();
+    m_built = m_rebuild = false;
+}
+
+int CallGraphIndex::count() const { return m_functions.size(); }
+int CallGraphIndex::functionIndex(address_t address) const { return m_functionindex.value(address, -1); }
+REDasm::ListingItem *CallGraphIndex::function(int idx) const { return ((idx >= 0) && (idx < m_functions.size())) ? m_functions[idx] : NULL; }
+
+CallGraphIndex::Calls CallGraphIndex::callees(int idx) const
+{
+    if((idx < 0) || (idx + 1 >= m_calleeoffsets.size()))
+        return Calls(nullptr, nullptr);
+
+    return Calls(m_callees.constData() + m_calleeoffsets[idx], m_callees.constData() + m_calleeoffsets[idx + 1]);
+}
+
+CallGraphIndex::Calls CallGraphIndex::callers(int idx) const
+{
+    if((idx < 0) || (idx + 1 >= m_calleroffsets.size()))
+        return Calls(nullptr, nullptr);
+
+    return Calls(m_callers.constData() + m_calleroffsets[idx], m_callers.constData() + m_calleroffsets[idx + 1]);
+}
+
+void CallGraphIndex::build()
+{
+    m_functions.clear();
+    m_functionindex.clear();
+    m_calleeoffsets.clear();
+
+    auto& document = m_disassembler->document();
+
+    for(auto it = document->begin(); it != document->end(); it++)
+    {
+        if((*it)->is(REDasm::ListingItem::FunctionItem))
+            this->addFunction(it->get());
+    }
+
+    QHash<int, QVector<Call> > rescanned;
+    rescanned.reserve(m_functions.size());
+
+    for(int i = 0; i < m_functions.size(); i++)
+        rescanned[i] = this->scan(m_functions[i]);
+
+    this->compact(rescanned);
+}
+
+int CallGraphIndex::addFunction(REDasm::ListingItem *item)
+{
+    int idx = m_functions.size();
+    m_functions.append(item);
+    m_functionindex[item->address] = idx;
+    return idx;
+}
+
+int CallGraphIndex::ownerFunction(address_t address) const
+{
+    REDasm::ListingItem* item = m_disassembler->document()->functionStart(address);
+
+    if(!item)
+        return -1;
+
+    return this->functionIndex(item->address);
+}
+
+QVector<CallGraphIndex::Call> CallGraphIndex::scan(REDasm::ListingItem *functionitem) const
+{
+    REDasm::ListingItems callsites = m_disassembler->getCalls(functionitem->address);
+    QVector<Call> calls;
+    calls.reserve(static_cast<int>(callsites.size()));
+
+    for(REDasm::ListingItem* callsite : callsites)
+    {
+        REDasm::ReferenceSet targets = m_disassembler->getTargets(callsite->address);
+        calls.append({ callsite, targets.empty() ? callsite->address : *targets.begin(), -1 });
+    }
+
+    return calls;
+}
+
+void CallGraphIndex::compact(const QHash<int, QVector<Call> > &rescanned)
+{
+    int count = m_functions.size(), oldcount = m_calleeoffsets.size() - 1;
+    QVector<int> calleeoffsets(count + 1);
+    QVector<Call> callees;
+    callees.reserve(m_callees.size());
+
+    // Forward arrays: rescanned functions replace their range, the others are copied as they are
+    for(int i = 0; i < count; i++)
+    {
+        calleeoffsets[i] = callees.size();
+
+        if(!m_functions[i])
+            continue;
+
+        auto it = rescanned.constFind(i);
+
+        if(it != rescanned.constEnd())
+            callees += it.value();
+        else if(i < oldcount)
+            std::copy(m_callees.constBegin() + m_calleeoffsets[i], m_callees.constBegin() + m_calleeoffsets[i + 1], std::back_inserter(callees));
+    }
+
+    calleeoffsets[count] = callees.size();
+
+    // Targets are resolved every time, functions can appear and disappear without rescanning their callers
+    QVector<int> calleroffsets(count + 1, 0);
+
+    for(Call& call : callees)
+    {
+        call.function = this->functionIndex(call.target);
+
+        if(call.function != -1)
+            calleroffsets[call.function + 1]++;
+    }
+
+    for(int i = 0; i < count; i++)
+        calleroffsets[i + 1] += calleroffsets[i];
+
+    // Reverse arrays, filled with a counting sort
+    QVector<int> positions = calleroffsets;
+    QVector<Call> callers(calleroffsets[count]);
+
+    for(int i = 0; i < count; i++)
+    {
+        for(int j = calleeoffsets[i]; j < calleeoffsets[i + 1]; j++)
+        {
+            const Call& call = callees[j];
+
+            if(call.function != -1)
+                callers[positions[call.function]++] = { call.callsite, m_functions[i]->address, i };
+        }
+    }
+
+    m_calleeoffsets.swap(calleeoffsets);
+    m_calleroffsets.swap(calleroffsets);
+    m_callees.swap(callees);
+    m_callers.swap(callers);
+}
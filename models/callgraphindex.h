@@ -0,0 +1,49 @@
+#ifndef CALLGRAPHINDEX_H
+#define CALLGRAPHINDEX_H
+
+#include <QVector>
+#include <QHash>
+#include <mutex>
+#include <redasm/disassembler/disassemblerapi.h>
+#include <redasm/disassembler/listing/listingdocument.h>
+
+class CallGraphIndex
+{
+    public:
+        struct Call { REDasm::ListingItem* callsite; address_t target; int function; }; // 'function' is the other end of the call, -1 if unresolved
+        typedef std::pair<const Call*, const Call*> Calls;
+
+    private:
+        struct Change { address_t address; bool function; };
+
+    public:
+        CallGraphIndex();
+        void setDisassembler(const REDasm::DisassemblerPtr& disassembler);
+        void invalidate(const REDasm::ListingDocumentChanged* ldc); // Thread safe
+        bool update();                                              // Returns true if the index has changed
+        void clear();
+        int count() const;
+        int functionIndex(address_t address) const;
+        REDasm::ListingItem* function(int idx) const;
+        Calls callees(int idx) const;                               // Calls made by 'idx', 'function' is the callee
+        Calls callers(int idx) const;                               // Calls targeting 'idx', 'function' is the caller
+
+    private:
+        void build();
+        int addFunction(REDasm::ListingItem* item);
+        int ownerFunction(address_t address) const;
+        QVector<Call> scan(REDasm::ListingItem* functionitem) const;
+        void compact(const QHash<int, QVector<Call> >& rescanned);
+
+    private:
+        REDasm::DisassemblerPtr m_disassembler;
+        QVector<REDasm::ListingItem*> m_functions;     // Removed functions are left as NULL, indices are stable
+        QHash<address_t, int> m_functionindex;
+        QVector<int> m_calleeoffsets, m_calleroffsets; // CSR: calls of function 'i' are in [offsets[i], offsets[i + 1])
+        QVector<Call> m_callees, m_callers;
+        QVector<Change> m_changes;
+        std::mutex m_mutex;
+        bool m_built, m_rebuild;
+};
+
+#endif // CALLGRAPHINDEX_H
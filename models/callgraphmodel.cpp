@@ -4,143 +4,220 @@
 #include <QFontDatabase>
 #include <QColor>
 
-CallGraphModel::CallGraphModel(QObject *parent) : QAbstractItemModel(parent), m_disassembler(NULL), m_root(NULL) { }
+CallGraphModel::CallGraphModel(QObject *parent) : QAbstractItemModel(parent), m_disassembler(NULL), m_mode(CallGraphModel::CalleesMode), m_stale(false) { }
+
+CallGraphModel::~CallGraphModel()
+{
+    if(!m_disassembler)
+        return;
+
+    EVENT_DISCONNECT(m_disassembler->document(), changed, this);
+    EVENT_DISCONNECT(m_disassembler, busyChanged, this);
+}
 
 void CallGraphModel::setDisassembler(const REDasm::DisassemblerPtr &disassembler)
 {
     m_disassembler = disassembler;
     m_printer = REDasm::PrinterPtr(m_disassembler->assembler()->createPrinter(m_disassembler.get()));
+    m_index.setDisassembler(disassembler);
+
+    EVENT_CONNECT(m_disassembler->document(), changed, this, [&](const REDasm::ListingDocumentChanged* ldc) {
+        m_index.invalidate(ldc);
+    });
+
+    EVENT_CONNECT(m_disassembler, busyChanged, this, [&]() {
+        if(m_disassembler->busy())
+            return;
+
+        QMetaObject::invokeMethod(this, "updateIndex", Qt::QueuedConnection);
+    });
 }
 
-void CallGraphModel::initializeGraph(address_t address)
+bool CallGraphModel::initializeGraph(address_t address)
 {
-    this->clearGraph();
+    bool changed = m_index.update();
+    int function = m_index.functionIndex(address);
 
-    REDasm::ListingDocument& document = m_disassembler->document();
-    auto it = document->functionItem(address);
+    if(!changed && !m_stale && !m_nodes.empty() && (m_nodes.front().function == function))
+        return false;
 
-    if(it != document->end())
-    {
-        m_root = it->get();
-        m_depths[m_root] = 0;
-        m_parents[m_root] = NULL;
-        this->populate(m_root);
-    }
+    this->beginResetModel();
+    m_nodes.clear();
+    m_seen.fill(false, m_index.count());
+    m_stale = false;
+
+    if(function != -1)
+        this->createNode(m_index.function(function), address, function, NULL);
+
+    this->endResetModel();
+
+    if(!m_nodes.empty())
+        this->populate(&m_nodes.front());
+
+    return true;
 }
 
 void CallGraphModel::clearGraph()
 {
     this->beginResetModel();
-    m_root = NULL;
-    m_depths.clear();
-    m_children.clear();
-    m_parents.clear();
+    m_nodes.clear();
+    m_seen.clear();
+    m_stale = false;
     this->endResetModel();
 }
 
-void CallGraphModel::populateCallGraph(const QModelIndex &index) { this->populate(reinterpret_cast<REDasm::ListingItem*>(index.internalPointer())); }
-
-void CallGraphModel::populate(REDasm::ListingItem* parentitem)
+void CallGraphModel::setMode(int mode)
 {
-    if(m_children.contains(parentitem))
+    if(mode == m_mode)
         return;
 
-    REDasm::ListingItems calls = m_disassembler->getCalls(parentitem->address);
-    QModelIndex index;
-
-    if(parentitem != m_root)
-        index = this->createIndex(this->getParentIndex(parentitem), 0, parentitem);
+    m_mode = mode;
 
-    this->beginInsertRows(index, 0, static_cast<int>(calls.size()));
-    m_children[parentitem] = calls;
+    if(m_nodes.empty())
+        return;
 
-    for(REDasm::ListingItem* item : m_children[parentitem])
+    if(m_disassembler->busy()) // The index cannot be read now, rebuilt by updateIndex() when idle
     {
-        m_parents[item] = parentitem;
-
-        if(!m_depths.contains(item))
-            m_depths[item] = m_depths[parentitem] + 1;
+        m_stale = true;
+        return;
     }
 
-    this->endInsertRows();
+    address_t address = m_nodes.front().target;
+    this->clearGraph();
+    this->initializeGraph(address);
 }
 
-bool CallGraphModel::isDuplicate(const QModelIndex &index) const
+REDasm::ListingItem *CallGraphModel::item(const QModelIndex &index) const
 {
-    REDasm::ListingItem* item = reinterpret_cast<REDasm::ListingItem*>(index.internalPointer());
+    if(!index.isValid() || !index.internalPointer())
+        return NULL;
 
-    if(item == m_root)
-        return false;
+    return reinterpret_cast<Node*>(index.internalPointer())->item;
+}
 
-    QModelIndex parentindex = this->parent(index);
-    REDasm::ListingItem* parentitem = reinterpret_cast<REDasm::ListingItem*>(parentindex.internalPointer());
-    return (m_depths[item] - m_depths[parentitem]) != 1;
+address_t CallGraphModel::target(const QModelIndex &index) const
+{
+    if(!index.isValid() || !index.internalPointer())
+        return 0;
+
+    return reinterpret_cast<Node*>(index.internalPointer())->target;
 }
 
-int CallGraphModel::getParentIndexFromChild(REDasm::ListingItem *childitem) const
+void CallGraphModel::populateCallGraph(const QModelIndex &index) { this->populate(reinterpret_cast<Node*>(index.internalPointer())); }
+
+void CallGraphModel::updateIndex()
 {
-    if(childitem == m_root)
-        return -1;
+    if(m_disassembler->busy())
+        return;
 
-    REDasm::ListingItem* parentitem = m_parents[childitem];
-    return this->getParentIndex(parentitem);
+    bool changed = m_index.update() || m_stale;
+    m_stale = false;
+
+    if(!changed || m_nodes.empty())
+        return;
+
+    address_t address = m_nodes.front().target; // Call sites can be gone, rebuild the tree from its root
+    this->clearGraph();
+    this->initializeGraph(address);
 }
 
-int CallGraphModel::getParentIndex(REDasm::ListingItem *parentitem) const
+void CallGraphModel::populate(Node *node)
 {
-    const REDasm::ListingItems& parentlist = m_children[m_parents[parentitem]];
-    return REDasm::Listing::indexOf(&parentlist, parentitem);
+    if(!node || node->populated || node->duplicate)
+        return;
+
+    node->populated = true;
+    CallGraphIndex::Calls calls = this->calls(node->function);
+
+    if(calls.first == calls.second)
+        return;
+
+    this->beginInsertRows(this->createIndex(node->row, 0, node), 0, static_cast<int>(calls.second - calls.first) - 1);
+
+    for(const CallGraphIndex::Call* call = calls.first; call != calls.second; call++)
+        this->createNode(call->callsite, call->target, call->function, node);
+
+    this->endInsertRows();
+}
+
+CallGraphModel::Node *CallGraphModel::createNode(REDasm::ListingItem *item, address_t target, int function, Node *parent)
+{
+    m_nodes.push_back({ item, target, parent, parent ? parent->children.size() : 0, function, false, false, { } });
+    Node* node = &m_nodes.back();
+
+    if(function != -1)
+    {
+        // Callers of a function legitimately show up on many paths, only cycles are cut there
+        node->duplicate = CallGraphModel::isRecursive(parent, function) || ((m_mode == CallGraphModel::CalleesMode) && m_seen[function]);
+        m_seen[function] = true;
+    }
+
+    if(parent)
+        parent->children.append(node);
+
+    return node;
+}
+
+CallGraphIndex::Calls CallGraphModel::calls(int function) const { return (m_mode == CallGraphModel::CallersMode) ? m_index.callers(function) : m_index.callees(function); }
+
+bool CallGraphModel::isRecursive(const Node *node, int function)
+{
+    for( ; node; node = node->parent)
+    {
+        if(node->function == function)
+            return true;
+    }
+
+    return false;
 }
 
 bool CallGraphModel::hasChildren(const QModelIndex &parentindex) const
 {
-    if(!m_disassembler || !m_root || m_children.empty())
+    if(!m_disassembler || m_nodes.empty())
         return false;
 
-    REDasm::ListingItem* parentitem = reinterpret_cast<REDasm::ListingItem*>(parentindex.internalPointer());
+    const Node* node = reinterpret_cast<const Node*>(parentindex.internalPointer());
 
-    if(!parentitem)
+    if(!node)
         return true;
 
-    if(this->isDuplicate(parentindex))
+    if(node->duplicate || (node->function == -1))
         return false;
 
-    if(m_children.contains(parentitem))
-    {
-        const REDasm::ListingItems& children = m_children[parentitem];
-
-        if(children.empty())
-            return false;
-    }
+    if(node->populated)
+        return !node->children.empty();
 
-    return true;
+    CallGraphIndex::Calls calls = this->calls(node->function);
+    return calls.first != calls.second;
 }
 
 QModelIndex CallGraphModel::index(int row, int column, const QModelIndex &parent) const
 {
-    if(!m_disassembler || !m_root || m_children.empty())
+    if(!m_disassembler || m_nodes.empty() || (row < 0))
         return QModelIndex();
 
-    REDasm::ListingItem* parentitem = reinterpret_cast<REDasm::ListingItem*>(parent.internalPointer());
+    const Node* parentnode = reinterpret_cast<const Node*>(parent.internalPointer());
 
-    if(!parentitem)
-        return this->createIndex(row, column, m_root);
+    if(!parentnode)
+        return row ? QModelIndex() : this->createIndex(row, column, const_cast<Node*>(&m_nodes.front()));
 
-    return this->createIndex(row, column, m_children[parentitem][row]);
+    if(row >= parentnode->children.size())
+        return QModelIndex();
+
+    return this->createIndex(row, column, parentnode->children[row]);
 }
 
 QModelIndex CallGraphModel::parent(const QModelIndex &child) const
 {
-    if(!m_disassembler || !m_root)
+    if(!m_disassembler || m_nodes.empty() || !child.isValid())
         return QModelIndex();
 
-    REDasm::ListingItem* childitem = reinterpret_cast<REDasm::ListingItem*>(child.internalPointer());
+    const Node* node = reinterpret_cast<const Node*>(child.internalPointer());
 
-    if(childitem == m_root)
+    if(!node->parent)
         return QModelIndex();
 
-    REDasm::ListingItem* parentitem = m_parents[childitem];
-    return this->createIndex(this->getParentIndexFromChild(childitem), 0, parentitem);
+    return this->createIndex(node->parent->row, 0, node->parent);
 }
 
 QVariant CallGraphModel::headerData(int section, Qt::Orientation orientation, int role) const
@@ -167,20 +244,13 @@ QVariant CallGraphModel::headerData(int section, Qt::Orientation orientation, in
 
 QVariant CallGraphModel::data(const QModelIndex &index, int role) const
 {
-    if(!m_disassembler || m_disassembler->busy() || !m_root)
+    if(!m_disassembler || m_disassembler->busy() || m_nodes.empty())
         return QVariant();
 
     auto lock = REDasm::s_lock_safe_ptr(m_disassembler->document());
-    REDasm::ListingItem* item = reinterpret_cast<REDasm::ListingItem*>(index.internalPointer());
-    const REDasm::Symbol* symbol = lock->symbol(item->address);
-
-    if(item->is(REDasm::ListingItem::InstructionItem))
-    {
-        REDasm::ReferenceSet refs = m_disassembler->getTargets(item->address);
-
-        if(!refs.empty())
-            symbol = lock->symbol(*refs.begin());
-    }
+    const Node* node = reinterpret_cast<const Node*>(index.internalPointer());
+    const REDasm::ListingItem* item = node->item;
+    const REDasm::Symbol* symbol = lock->symbol(node->target);
 
     if(role == Qt::DisplayRole)
     {
@@ -188,19 +258,24 @@ QVariant CallGraphModel::data(const QModelIndex &index, int role) const
             return QString::fromStdString(REDasm::hex(item->address, m_disassembler->assembler()->bits()));
         else if(index.column() == 1)
         {
-            if(item->is(REDasm::ListingItem::FunctionItem))
-                return QString::fromStdString(symbol->name);
+            if(item->is(REDasm::ListingItem::FunctionItem) || (m_mode == CallGraphModel::CallersMode)) // Callers are shown by name
+                return symbol ? QString::fromStdString(symbol->name) : QString();
 
             return QString::fromStdString(m_printer->out(lock->instruction(item->address)));
         }
         else if(index.column() == 2)
-            return item == m_root ? "---" : QString::number(m_disassembler->getReferencesCount(item->address));
+        {
+            if(!node->parent)
+                return "---";
+
+            return QString::number(m_disassembler->getReferencesCount((m_mode == CallGraphModel::CallersMode) ? node->target : item->address));
+        }
     }
     else if(role == Qt::ForegroundRole)
     {
         if(index.column() == 0)
             return QColor(Qt::darkBlue);
-        else if((index.column() == 1) && this->isDuplicate(index) && !symbol->isLocked())
+        else if((index.column() == 1) && node->duplicate && (!symbol || !symbol->isLocked()))
             return QColor(Qt::gray);
     }
     else if(role == Qt::BackgroundColorRole && symbol && symbol->isLocked())
@@ -215,13 +290,13 @@ int CallGraphModel::columnCount(const QModelIndex &parent) const { Q_UNUSED(pare
 
 int CallGraphModel::rowCount(const QModelIndex &parent) const
 {
-    if(!m_disassembler || m_disassembler->busy() || !m_root || m_children.empty())
+    if(!m_disassembler || m_disassembler->busy() || m_nodes.empty())
         return 0;
 
-    REDasm::ListingItem* parentitem = reinterpret_cast<REDasm::ListingItem*>(parent.internalPointer());
+    const Node* node = reinterpret_cast<const Node*>(parent.internalPointer());
 
-    if(!parentitem)
+    if(!node)
         return 1;
 
-    return static_cast<int>(m_children[parentitem].size());
+    return node->children.size();
 }
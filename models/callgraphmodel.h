@@ -2,29 +2,51 @@
 #define CALLGRAPHMODEL_H
 
 #include <QAbstractItemModel>
-#include <QHash>
+#include <deque>
 #include <redasm/disassembler/disassemblerapi.h>
 #include <redasm/plugins/assembler/printer.h>
 #include <redasm/disassembler/listing/listingdocument.h>
+#include "callgraphindex.h"
 
 class CallGraphModel : public QAbstractItemModel
 {
     Q_OBJECT
 
+    private:
+        struct Node
+        {
+            REDasm::ListingItem* item; // Function item for the root, call site otherwise
+            address_t target;
+            Node* parent;
+            int row, function;         // 'function' is the function expanded below this node, -1 for unresolved calls
+            bool duplicate, populated; // Duplicates are not expanded
+            QVector<Node*> children;
+        };
+
+    public:
+        enum { CalleesMode = 0, CallersMode };
+
     public:
         explicit CallGraphModel(QObject *parent = nullptr);
+        virtual ~CallGraphModel();
         void setDisassembler(const REDasm::DisassemblerPtr& disassembler);
-        void initializeGraph(address_t address);
+        bool initializeGraph(address_t address); // Returns false if the current graph is still valid
         void clearGraph();
+        void setMode(int mode);
+        REDasm::ListingItem* item(const QModelIndex& index) const;
+        address_t target(const QModelIndex& index) const; // Callee in callees mode, caller function in callers mode
 
     public slots:
         void populateCallGraph(const QModelIndex& index);
 
+    private slots:
+        void updateIndex();
+
     private:
-        void populate(REDasm::ListingItem *parentitem);
-        bool isDuplicate(const QModelIndex& index) const;
-        int getParentIndexFromChild(REDasm::ListingItem *childitem) const;
-        int getParentIndex(REDasm::ListingItem *parentitem) const;
+        void populate(Node* node);
+        Node* createNode(REDasm::ListingItem* item, address_t target, int function, Node* parent);
+        CallGraphIndex::Calls calls(int function) const;
+        static bool isRecursive(const Node* node, int function);
 
     public:
         virtual bool hasChildren(const QModelIndex& parentindex) const;
@@ -38,10 +60,11 @@ class CallGraphModel : public QAbstractItemModel
     private:
         REDasm::PrinterPtr m_printer;
         REDasm::DisassemblerPtr m_disassembler;
-        REDasm::ListingItem* m_root;
-        QHash<REDasm::ListingItem*, s32> m_depths;
-        QHash<REDasm::ListingItem*, REDasm::ListingItems> m_children;
-        QHash<REDasm::ListingItem*, REDasm::ListingItem*> m_parents;
+        CallGraphIndex m_index;
+        std::deque<Node> m_nodes;  // Stable addresses, Node* is the internal pointer
+        QVector<bool> m_seen;      // Functions already shown somewhere in the tree
+        int m_mode;
+        bool m_stale;              // Mode switched while busy
 };
 
 #endif // CALLGRAPHMODEL_H
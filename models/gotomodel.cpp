@@ -17,9 +17,9 @@ QVariant GotoModel::data(const QModelIndex &index, int role) const
         if(index.column() == 0)
             return S_TO_QS(REDasm::hex(item->address, m_disassembler->assembler()->bits()));
         if(index.column() == 1)
-            return this->itemName(item);
+            return this->itemName(item->address, item->type);
         if(index.column() == 2)
-            return this->itemType(item);
+            return GotoModel::itemType(item->type);
     }
     else if(role == Qt::TextAlignmentRole)
     {
@@ -84,39 +84,44 @@ QColor GotoModel::itemColor(const REDasm::ListingItem *item) const
     return QColor();
 }
 
-QString GotoModel::itemName(const REDasm::ListingItem *item) const
+QString GotoModel::filterText(const ListedItem &item) const
+{
+    return S_TO_QS(REDasm::hex(item.address, m_disassembler->assembler()->bits())) + '\n' + this->itemName(item.address, item.type) + '\n' + GotoModel::itemType(item.type);
+}
+
+QString GotoModel::itemName(address_t address, size_t type) const
 {
     const REDasm::ListingDocument& document = m_disassembler->document();
 
-    if(item->type == REDasm::ListingItem::SegmentItem)
+    if(type == REDasm::ListingItem::SegmentItem)
     {
-        const REDasm::Segment* segment = document->segment(item->address);
+        const REDasm::Segment* segment = document->segment(address);
 
         if(segment)
             return S_TO_QS(segment->name);
     }
-    else if((item->type == REDasm::ListingItem::FunctionItem) || (item->type == REDasm::ListingItem::SymbolItem))
+    else if((type == REDasm::ListingItem::FunctionItem) || (type == REDasm::ListingItem::SymbolItem))
     {
-        const REDasm::Symbol* symbol = document->symbol(item->address);
+        const REDasm::Symbol* symbol = document->symbol(address);
 
         if(symbol)
             return S_TO_QS(REDasm::Demangler::demangled(symbol->name));
     }
-    else if(item->type == REDasm::ListingItem::TypeItem)
-        return S_TO_QS(document->type(item->address));
+    else if(type == REDasm::ListingItem::TypeItem)
+        return S_TO_QS(document->type(address));
 
     return QString();
 }
 
-QString GotoModel::itemType(const REDasm::ListingItem *item) const
+QString GotoModel::itemType(size_t type)
 {
-    if(item->type == REDasm::ListingItem::SegmentItem)
+    if(type == REDasm::ListingItem::SegmentItem)
         return "SEGMENT";
-    if(item->type == REDasm::ListingItem::FunctionItem)
+    if(type == REDasm::ListingItem::FunctionItem)
         return "FUNCTION";
-    if(item->type == REDasm::ListingItem::TypeItem)
+    if(type == REDasm::ListingItem::TypeItem)
         return "TYPE";
-    if(item->type == REDasm::ListingItem::SymbolItem)
+    if(type == REDasm::ListingItem::SymbolItem)
         return "SYMBOL";
 
     return QString();
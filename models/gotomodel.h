@@ -15,11 +15,12 @@ class GotoModel : public ListingItemModel
         virtual QVariant data(const QModelIndex &index, int role) const;
         virtual QVariant headerData(int section, Qt::Orientation orientation, int role) const;
         virtual int columnCount(const QModelIndex&) const;
+        virtual QString filterText(const ListedItem& item) const;
 
     private:
         QColor itemColor(const REDasm::ListingItem* item) const;
-        QString itemName(const REDasm::ListingItem* item) const;
-        QString itemType(const REDasm::ListingItem* item) const;
+        QString itemName(address_t address, size_t type) const;
+        static QString itemType(size_t type);
 
     protected:
         virtual bool isItemAllowed(REDasm::ListingItem* item) const;
@@ -0,0 +1,53 @@
+#include "listingfilterjob.h"
+
+#define FILTER_CHUNK_SIZE 4096
+
+ListingFilterJob::Index::Index(const ListingItemModel *model, const QVector<ListingItemModel::ListedItem> &items): model(model), items(items) { }
+
+ListingFilterJob::ListingFilterJob(QObject *receiver, const IndexPtr &index, const QString &filter, const QVector<int> &candidates, bool refine, quint64 generation, const std::atomic<quint64> *currentgeneration): QRunnable(), m_receiver(receiver), m_index(index), m_filter(filter), m_candidates(candidates), m_refine(refine), m_generation(generation), m_currentgeneration(currentgeneration) { }
+
+void ListingFilterJob::run()
+{
+    if(this->cancelled() || !this->buildIndex())
+        return;
+
+    const TrigramIndex& trigrams = m_index->trigrams;
+
+    if(!m_refine)
+        m_candidates = trigrams.candidates(m_filter);
+
+    int i = 0;
+
+    do
+    {
+        if(this->cancelled()) // Filter changed, drop this pass
+            return;
+
+        QVector<int> rows = trigrams.refine(m_candidates.mid(i, FILTER_CHUNK_SIZE), m_filter);
+        i += FILTER_CHUNK_SIZE;
+
+        QMetaObject::invokeMethod(m_receiver, "publishRows", Qt::QueuedConnection, Q_ARG(quint64, m_generation),
+                                  Q_ARG(QVector<int>, rows), Q_ARG(bool, i >= m_candidates.size()));
+    }
+    while(i < m_candidates.size());
+}
+
+bool ListingFilterJob::buildIndex()
+{
+    TrigramIndex& trigrams = m_index->trigrams;
+
+    if(!trigrams.size())
+        trigrams.reserve(m_index->items.size());
+
+    for(int i = trigrams.size(); i < m_index->items.size(); i++)
+    {
+        if(!(i % FILTER_CHUNK_SIZE) && this->cancelled()) // Rows added so far are kept for the next pass
+            return false;
+
+        trigrams.add(m_index->model->filterText(m_index->items[i]));
+    }
+
+    return true;
+}
+
+bool ListingFilterJob::cancelled() const { return m_currentgeneration->load() != m_generation; }
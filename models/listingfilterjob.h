@@ -0,0 +1,42 @@
+#ifndef LISTINGFILTERJOB_H
+#define LISTINGFILTERJOB_H
+
+#include <QRunnable>
+#include <QObject>
+#include <atomic>
+#include <memory>
+#include "listingitemmodel.h"
+#include "trigramindex.h"
+
+class ListingFilterJob : public QRunnable
+{
+    public:
+        struct Index
+        {
+            Index(const ListingItemModel* model, const QVector<ListingItemModel::ListedItem>& items);
+            const ListingItemModel* model;
+            const QVector<ListingItemModel::ListedItem> items; // Snapshot of the source rows, also read by the GUI thread
+            TrigramIndex trigrams;                             // Worker thread only, jobs resume where the previous one stopped
+        };
+
+        typedef std::shared_ptr<Index> IndexPtr;
+
+    public:
+        ListingFilterJob(QObject* receiver, const IndexPtr& index, const QString& filter, const QVector<int>& candidates, bool refine, quint64 generation, const std::atomic<quint64>* currentgeneration);
+        virtual void run();
+
+    private:
+        bool buildIndex();
+        bool cancelled() const;
+
+    private:
+        QObject* m_receiver;
+        IndexPtr m_index;
+        QString m_filter;
+        QVector<int> m_candidates;
+        bool m_refine;
+        quint64 m_generation;
+        const std::atomic<quint64>* m_currentgeneration;
+};
+
+#endif // LISTINGFILTERJOB_H
@@ -2,7 +2,18 @@
 
 #define FILTER_MIN_CHARS 2
 
-ListingFilterModel::ListingFilterModel(QObject *parent) : QIdentityProxyModel(parent) { }
+ListingFilterModel::ListingFilterModel(QObject *parent) : QIdentityProxyModel(parent), m_generation(0), m_indexdirty(true), m_filtering(false), m_pendingreset(false)
+{
+    qRegisterMetaType< QVector<int> >("QVector<int>");
+    m_pool.setMaxThreadCount(1); // Passes are cancelled, not run concurrently
+}
+
+ListingFilterModel::~ListingFilterModel()
+{
+    m_generation++;
+    m_pool.waitForDone();
+}
+
 const QString &ListingFilterModel::filter() const { return m_filterstring; }
 void ListingFilterModel::setDisassembler(const REDasm::DisassemblerPtr& disassembler) { reinterpret_cast<ListingItemModel*>(this->sourceModel())->setDisassembler(disassembler); }
 
@@ -24,9 +35,22 @@ void ListingFilterModel::clearFilter()
     this->updateFiltering();
 }
 
+void ListingFilterModel::setSourceModel(QAbstractItemModel *sourcemodel)
+{
+    QIdentityProxyModel::setSourceModel(sourcemodel);
+    m_indexdirty = true;
+
+    auto invalidate = [&]() { m_indexdirty = true; };
+    connect(sourcemodel, &QAbstractItemModel::modelReset, this, invalidate);
+    connect(sourcemodel, &QAbstractItemModel::layoutChanged, this, invalidate);
+    connect(sourcemodel, &QAbstractItemModel::rowsInserted, this, invalidate);
+    connect(sourcemodel, &QAbstractItemModel::rowsRemoved, this, invalidate);
+    connect(sourcemodel, &QAbstractItemModel::dataChanged, this, invalidate);
+}
+
 int ListingFilterModel::rowCount(const QModelIndex& parent) const
 {
-    if(!this->canFilter())
+    if(!m_filtering)
         return QIdentityProxyModel::rowCount(parent);
 
     return m_filtereditems.count();
@@ -34,7 +58,7 @@ int ListingFilterModel::rowCount(const QModelIndex& parent) const
 
 QModelIndex ListingFilterModel::index(int row, int column, const QModelIndex&) const
 {
-    if(!this->canFilter())
+    if(!m_filtering)
         return QIdentityProxyModel::index(row, column);
 
     if(m_filtereditems.empty())
@@ -45,11 +69,10 @@ QModelIndex ListingFilterModel::index(int row, int column, const QModelIndex&) c
 
 QModelIndex ListingFilterModel::mapFromSource(const QModelIndex &sourceindex) const
 {
-    if(!this->canFilter() || !sourceindex.isValid())
+    if(!m_filtering || !sourceindex.isValid())
         return QIdentityProxyModel::mapFromSource(sourceindex);
 
-    REDasm::ListingItem* item = reinterpret_cast<REDasm::ListingItem*>(sourceindex.internalPointer());
-    int idx = REDasm::Listing::indexOf(&m_filtereditems, item);
+    int idx = m_filteredmap.value(reinterpret_cast<REDasm::ListingItem*>(sourceindex.internalPointer()), -1);
 
     if(idx == -1)
         return QModelIndex();
@@ -59,12 +82,15 @@ QModelIndex ListingFilterModel::mapFromSource(const QModelIndex &sourceindex) co
 
 QModelIndex ListingFilterModel::mapToSource(const QModelIndex &proxyindex) const
 {
-    if(!this->canFilter() || !proxyindex.isValid())
+    if(!m_filtering || !proxyindex.isValid())
         return QIdentityProxyModel::mapToSource(proxyindex);
 
+    if(!m_indexdirty) // Indexed rows match source rows
+        return this->sourceModel()->index(m_filteredrows[proxyindex.row()], proxyindex.column());
+
+    // Source rows have moved since the last snapshot
     ListingItemModel* listingitemmodel = reinterpret_cast<ListingItemModel*>(this->sourceModel());
-    REDasm::ListingItem* item = reinterpret_cast<REDasm::ListingItem*>(proxyindex.internalPointer());
-    int idx = REDasm::Listing::indexOf(&listingitemmodel->m_items, item);
+    int idx = listingitemmodel->itemRow(reinterpret_cast<REDasm::ListingItem*>(proxyindex.internalPointer()));
 
     if(idx == -1)
         return QModelIndex();
@@ -72,32 +98,87 @@ QModelIndex ListingFilterModel::mapToSource(const QModelIndex &proxyindex) const
     return listingitemmodel->index(idx, proxyindex.column());
 }
 
-void ListingFilterModel::updateFiltering()
+void ListingFilterModel::publishRows(quint64 generation, const QVector<int> &rows, bool last)
 {
-    this->beginResetModel();
-    m_filtereditems.clear();
+    if(generation != m_generation) // Results of a cancelled pass
+        return;
 
-    if(this->canFilter())
+    if(m_pendingreset) // Keep previous results visible until the first chunk arrives
     {
-        QAbstractItemModel* sourcemodel = this->sourceModel();
+        this->beginResetModel();
+        this->clearRows();
+        m_pendingreset = false;
+        this->endResetModel();
+    }
 
-        for(int i = 0; i < sourcemodel->rowCount(); i++)
+    if(!rows.empty())
+    {
+        int first = m_filtereditems.size();
+        this->beginInsertRows(QModelIndex(), first, first + rows.size() - 1);
+
+        for(int row : rows)
         {
-            for(int j = 0; j < sourcemodel->columnCount(); j++)
-            {
-                QModelIndex index = sourcemodel->index(i, j);
-                QVariant data = sourcemodel->data(index);
+            REDasm::ListingItem* item = m_index->items[row].item;
+            m_filteredmap[item] = m_filtereditems.size();
+            m_filtereditems.append(item);
+            m_filteredrows.append(row);
+        }
 
-                if((data.type() != QVariant::String) || (data.toString().indexOf(m_filterstring, 0, Qt::CaseInsensitive) == -1))
-                    continue;
+        this->endInsertRows();
+    }
 
-                m_filtereditems.append(reinterpret_cast<REDasm::ListingItem*>(index.internalPointer()));
-                break;
-            }
-        }
+    if(last)
+        m_lastfilterstring = m_filterstring;
+}
+
+void ListingFilterModel::clearRows()
+{
+    m_filtereditems.clear();
+    m_filteredmap.clear();
+    m_filteredrows.clear();
+}
+
+void ListingFilterModel::updateFiltering()
+{
+    m_generation++;
+
+    if(!this->canFilter())
+    {
+        this->beginResetModel();
+        this->clearRows();
+        m_lastfilterstring.clear();
+        m_filtering = m_pendingreset = false;
+        this->endResetModel();
+        return;
     }
 
-    this->endResetModel();
+    // A longer filter can only match a subset of the previous (complete) results
+    bool refine = !m_indexdirty && !m_lastfilterstring.isEmpty() && m_filterstring.contains(m_lastfilterstring, Qt::CaseInsensitive);
+    QVector<int> candidates = refine ? m_filteredrows : QVector<int>();
+
+    if(!m_filtering || m_indexdirty) // Rows from the previous index cannot be kept
+    {
+        this->beginResetModel();
+        this->clearRows();
+        m_filtering = true;
+        this->updateIndex();
+        this->endResetModel();
+    }
+
+    m_lastfilterstring.clear();
+    m_pendingreset = true;
+    m_pool.start(new ListingFilterJob(this, m_index, m_filterstring, candidates, refine, m_generation, &m_generation));
+}
+
+void ListingFilterModel::updateIndex()
+{
+    if(!m_indexdirty)
+        return;
+
+    // Rows are formatted and indexed by the jobs, only the item list is copied here
+    ListingItemModel* listingitemmodel = reinterpret_cast<ListingItemModel*>(this->sourceModel());
+    m_index = std::make_shared<ListingFilterJob::Index>(listingitemmodel, listingitemmodel->m_items);
+    m_indexdirty = false;
 }
 
 bool ListingFilterModel::canFilter() const { return m_filterstring.length() >= FILTER_MIN_CHARS; }
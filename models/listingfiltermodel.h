@@ -2,7 +2,11 @@
 #define LISTINGFILTERMODEL_H
 
 #include <QSortFilterProxyModel>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
 #include "listingitemmodel.h"
+#include "listingfilterjob.h"
 
 class ListingFilterModel : public QIdentityProxyModel
 {
@@ -10,19 +14,26 @@ class ListingFilterModel : public QIdentityProxyModel
 
     public:
         explicit ListingFilterModel(QObject *parent = nullptr);
+        virtual ~ListingFilterModel();
         const QString& filter() const;
         void setDisassembler(const REDasm::DisassemblerPtr &disassembler);
         void setFilter(const QString& filter);
         void clearFilter();
 
     public:
+        virtual void setSourceModel(QAbstractItemModel* sourcemodel);
         virtual int rowCount(const QModelIndex& parent = QModelIndex()) const;
         virtual QModelIndex index(int row, int column, const QModelIndex& = QModelIndex()) const;
         virtual QModelIndex mapFromSource(const QModelIndex& sourceindex) const;
         virtual QModelIndex mapToSource(const QModelIndex& proxyindex) const;
 
+    private slots:
+        void publishRows(quint64 generation, const QVector<int>& rows, bool last);
+
     private:
+        void clearRows();
         void updateFiltering();
+        void updateIndex();
         bool canFilter() const;
 
     public:
@@ -31,7 +42,13 @@ class ListingFilterModel : public QIdentityProxyModel
 
     private:
         QVector<REDasm::ListingItem*> m_filtereditems;
-        QString m_filterstring;
+        QHash<const REDasm::ListingItem*, int> m_filteredmap;
+        QVector<int> m_filteredrows;
+        QString m_filterstring, m_lastfilterstring;
+        ListingFilterJob::IndexPtr m_index; // Replaced when the source changes, its trigrams are built by the jobs
+        std::atomic<quint64> m_generation;
+        QThreadPool m_pool;
+        bool m_indexdirty, m_filtering, m_pendingreset;
 };
 
 template<typename T> ListingFilterModel *ListingFilterModel::createFilter(QObject *parent)
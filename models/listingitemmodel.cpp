@@ -4,8 +4,24 @@
 #include <redasm/plugins/loader.h>
 #include "../themeprovider.h"
 #include <QColor>
+#include <algorithm>
 
-ListingItemModel::ListingItemModel(size_t itemtype, QObject *parent) : DisassemblerModel(parent), m_itemtype(itemtype) { }
+#define FLUSH_INTERVAL 16 // Collect the insertions of a frame
+
+ListingItemModel::ListingItemModel(size_t itemtype, QObject *parent) : DisassemblerModel(parent), m_rowsgeneration(0), m_itemtype(itemtype), m_flushscheduled(false), m_deferred(false)
+{
+    m_flushtimer = new QTimer(this);
+    m_flushtimer->setSingleShot(true);
+    m_flushtimer->setInterval(FLUSH_INTERVAL);
+
+    connect(m_flushtimer, &QTimer::timeout, this, &ListingItemModel::flushPending);
+}
+
+ListingItemModel::~ListingItemModel()
+{
+    if(m_disassembler)
+        EVENT_DISCONNECT(m_disassembler, busyChanged, this);
+}
 
 void ListingItemModel::setDisassembler(const REDasm::DisassemblerPtr& disassembler)
 {
@@ -16,18 +32,28 @@ void ListingItemModel::setDisassembler(const REDasm::DisassemblerPtr& disassembl
 
     for(auto it = document->begin(); it != document->end(); it++)
     {
-        if(!this->isItemAllowed(it->get()))
-            continue;
-
-        auto itip = REDasm::Listing::insertionPoint(&m_items, it->get());
-        m_items.insert(itip, it->get());
+        if(this->isItemAllowed(it->get()))
+            m_items.append(ListingItemModel::listedItem(it->get()));
     }
 
+    std::sort(m_items.begin(), m_items.end(), &ListingItemModel::itemLessThan);
+    m_itemrows.clear();
     this->endResetModel();
 
     EVENT_CONNECT(document, changed, this, std::bind(&ListingItemModel::onListingChanged, this, std::placeholders::_1));
+
+    EVENT_CONNECT(m_disassembler, busyChanged, this, [&]() {
+        if(m_disassembler->busy())
+            return;
+
+        this->invalidateRows(); // References and names are final now
+        this->schedulePending();
+        QMetaObject::invokeMethod(this, "refreshRows", Qt::QueuedConnection);
+    });
 }
 
+void ListingItemModel::setDeferredPopulation(bool b) { m_deferred = b; }
+
 QModelIndex ListingItemModel::index(int row, int column, const QModelIndex &parent) const
 {
     Q_UNUSED(parent)
@@ -35,7 +61,7 @@ QModelIndex ListingItemModel::index(int row, int column, const QModelIndex &pare
     if((row < 0) || (row >= m_items.size()))
         return QModelIndex();
 
-    return this->createIndex(row, column, m_items[row]);
+    return this->createIndex(row, column, m_items[row].item);
 }
 
 int ListingItemModel::rowCount(const QModelIndex &) const { return m_items.size(); }
@@ -66,44 +92,25 @@ QVariant ListingItemModel::data(const QModelIndex &index, int role) const
     if(!index.isValid())
         return QVariant();
 
-    REDasm::ListingItem* item = reinterpret_cast<REDasm::ListingItem*>(index.internalPointer());
-    auto lock = REDasm::x_lock_safe_ptr(m_disassembler->document());
-    const REDasm::Symbol* symbol = lock->symbol(item->address);
+    CachedRow row;
 
-    if(!symbol)
+    if((index.row() >= m_items.size()) || !this->cachedRow(m_items[index.row()], &row))
         return QVariant();
 
     if(role == Qt::DisplayRole)
     {
         if(index.column() == 0)
-            return S_TO_QS(REDasm::hex(symbol->address, m_disassembler->assembler()->bits()));
-
+            return row.address;
         if(index.column() == 1)
-        {
-            if(symbol->is(REDasm::SymbolTypes::WideStringMask))
-                return S_TO_QS(REDasm::quoted(m_disassembler->readWString(symbol)));
-            else if(symbol->is(REDasm::SymbolTypes::StringMask))
-                return S_TO_QS(REDasm::quoted(m_disassembler->readString(symbol)));
-
-            return S_TO_QS(REDasm::Demangler::demangled(symbol->name));
-        }
-
+            return row.name;
         if(index.column() == 2)
-            return QString::number(m_disassembler->getReferencesCount(symbol->address));
-
+            return row.references;
         if(index.column() == 3)
-        {
-            REDasm::Segment* segment = lock->segment(symbol->address);
-
-            if(segment)
-                return S_TO_QS(segment->name);
-
-            return "???";
-        }
+            return row.segment;
     }
     else if(role == Qt::BackgroundRole)
     {
-        if(symbol->isFunction() && symbol->isLocked())
+        if(row.lockedfunction)
             return THEME_VALUE("locked_bg");
     }
     else if(role == Qt::ForegroundRole)
@@ -111,13 +118,23 @@ QVariant ListingItemModel::data(const QModelIndex &index, int role) const
         if(index.column() == 0)
             return THEME_VALUE("address_list_fg");
 
-        if(symbol->is(REDasm::SymbolTypes::String) && (index.column() == 1))
+        if(row.string && (index.column() == 1))
             return THEME_VALUE("string_fg");
     }
 
     return QVariant();
 }
 
+QString ListingItemModel::filterText(const ListedItem &item) const
+{
+    CachedRow row;
+
+    if(!this->cachedRow(item, &row))
+        return QString();
+
+    return row.address + '\n' + row.name + '\n' + row.references + '\n' + row.segment; // Matches cannot span columns
+}
+
 bool ListingItemModel::isItemAllowed(REDasm::ListingItem *item) const
 {
     if(m_itemtype == REDasm::ListingItem::AllItems)
@@ -126,26 +143,213 @@ bool ListingItemModel::isItemAllowed(REDasm::ListingItem *item) const
     return m_itemtype == item->type;
 }
 
+void ListingItemModel::refreshRows()
+{
+    if(m_items.empty())
+        return;
+
+    emit dataChanged(this->index(0, 0), this->index(m_items.size() - 1, this->columnCount() - 1));
+}
+
+void ListingItemModel::flushPending()
+{
+    QHash<REDasm::ListingItem*, ListedItem> inserted;
+    QSet<REDasm::ListingItem*> removed;
+
+    {
+        std::lock_guard<std::mutex> pendinglock(m_pendingmutex);
+        inserted.swap(m_pendinginserted);
+        removed.swap(m_pendingremoved);
+        m_flushscheduled = false;
+    }
+
+    if(inserted.empty() && removed.empty())
+        return;
+
+    // Items can be deleted at any time by the analysis, only their captured keys are compared
+    std::vector<ListedItem> newitems(inserted.begin(), inserted.end());
+    std::sort(newitems.begin(), newitems.end(), &ListingItemModel::itemLessThan);
+
+    emit layoutAboutToBeChanged();
+
+    QVector<ListedItem> items;
+    items.reserve(m_items.size() + static_cast<int>(newitems.size()));
+    auto it = newitems.begin();
+
+    for(const ListedItem& item : m_items)
+    {
+        if(removed.contains(item.item))
+            continue;
+
+        for( ; (it != newitems.end()) && ListingItemModel::itemLessThan(*it, item); it++)
+            items.append(*it);
+
+        items.append(item);
+    }
+
+    for( ; it != newitems.end(); it++)
+        items.append(*it);
+
+    m_items.swap(items);
+    m_itemrows.clear();
+
+    QModelIndexList oldindexes = this->persistentIndexList();
+
+    if(!oldindexes.empty())
+    {
+        QHash<const REDasm::ListingItem*, int> rows;
+        QModelIndexList newindexes;
+
+        for(int i = 0; i < m_items.size(); i++)
+            rows[m_items[i].item] = i;
+
+        for(const QModelIndex& index : oldindexes)
+        {
+            REDasm::ListingItem* item = reinterpret_cast<REDasm::ListingItem*>(index.internalPointer());
+            int row = removed.contains(item) ? -1 : rows.value(item, -1);
+            newindexes.append((row != -1) ? this->index(row, index.column()) : QModelIndex());
+        }
+
+        this->changePersistentIndexList(oldindexes, newindexes);
+    }
+
+    emit layoutChanged();
+}
+
+ListingItemModel::ListedItem ListingItemModel::listedItem(REDasm::ListingItem *item) { return { item, item->address, item->type }; }
+
+bool ListingItemModel::itemLessThan(const ListedItem &item1, const ListedItem &item2)
+{
+    // Same order as REDasm::Listing::insertionPoint(): address, then type.
+    // Listed types have at most one item per address, nothing else can tie.
+    if(item1.address == item2.address)
+        return item1.type < item2.type;
+
+    return item1.address < item2.address;
+}
+
+bool ListingItemModel::isPendingRemoval(const REDasm::ListingItem *item) const
+{
+    std::lock_guard<std::mutex> pendinglock(m_pendingmutex);
+    return m_pendingremoved.contains(const_cast<REDasm::ListingItem*>(item));
+}
+
+void ListingItemModel::schedulePending()
+{
+    {
+        std::lock_guard<std::mutex> pendinglock(m_pendingmutex);
+
+        if(m_flushscheduled || (m_pendinginserted.empty() && m_pendingremoved.empty()))
+            return;
+
+        if(m_deferred && m_disassembler->busy()) // Populate when analysis completes
+            return;
+
+        m_flushscheduled = true;
+    }
+
+    QMetaObject::invokeMethod(m_flushtimer, "start", Qt::QueuedConnection);
+}
+
+int ListingItemModel::itemRow(const REDasm::ListingItem *item) const
+{
+    if(m_itemrows.empty())
+    {
+        m_itemrows.reserve(m_items.size());
+
+        for(int i = 0; i < m_items.size(); i++)
+            m_itemrows[m_items[i].item] = i;
+    }
+
+    return m_itemrows.value(item, -1);
+}
+
+bool ListingItemModel::cachedRow(const ListedItem &item, CachedRow *row) const
+{
+    if(this->isPendingRemoval(item.item)) // Still listed, but deleted from the document: never dereferenced, only its address is used
+        return false;
+
+    u64 generation = 0;
+
+    {
+        std::lock_guard<std::mutex> rowslock(m_rowsmutex);
+        auto it = m_rows.find(item.item);
+
+        if(it != m_rows.end())
+        {
+            *row = it.value();
+            return true;
+        }
+
+        generation = m_rowsgeneration;
+    }
+
+    auto lock = REDasm::s_lock_safe_ptr(m_disassembler->document());
+    const REDasm::Symbol* symbol = lock->symbol(item.address);
+
+    if(!symbol)
+        return false;
+
+    row->address = S_TO_QS(REDasm::hex(symbol->address, m_disassembler->assembler()->bits()));
+
+    if(symbol->is(REDasm::SymbolTypes::WideStringMask))
+        row->name = S_TO_QS(REDasm::quoted(m_disassembler->readWString(symbol)));
+    else if(symbol->is(REDasm::SymbolTypes::StringMask))
+        row->name = S_TO_QS(REDasm::quoted(m_disassembler->readString(symbol)));
+    else
+        row->name = S_TO_QS(REDasm::Demangler::demangled(symbol->name));
+
+    row->references = QString::number(m_disassembler->getReferencesCount(symbol->address));
+
+    REDasm::Segment* segment = lock->segment(symbol->address);
+    row->segment = segment ? S_TO_QS(segment->name) : "???";
+    row->lockedfunction = symbol->isFunction() && symbol->isLocked();
+    row->string = symbol->is(REDasm::SymbolTypes::String);
+
+    std::lock_guard<std::mutex> rowslock(m_rowsmutex);
+
+    if(generation == m_rowsgeneration) // Don't store rows invalidated while formatting
+        m_rows[item.item] = *row;
+
+    return true;
+}
+
+void ListingItemModel::invalidateRow(const REDasm::ListingItem *item)
+{
+    std::lock_guard<std::mutex> rowslock(m_rowsmutex);
+    m_rows.remove(item);
+    m_rowsgeneration++;
+}
+
+void ListingItemModel::invalidateRows()
+{
+    std::lock_guard<std::mutex> rowslock(m_rowsmutex);
+    m_rows.clear();
+    m_rowsgeneration++;
+}
+
 void ListingItemModel::onListingChanged(const REDasm::ListingDocumentChanged *ldc)
 {
     if(!this->isItemAllowed(ldc->item))
         return;
 
+    if(!ldc->isInserted())
+        this->invalidateRow(ldc->item);
+
     if(ldc->isRemoved())
     {
-        int idx = REDasm::Listing::indexOf(&m_items, ldc->item);
+        std::lock_guard<std::mutex> pendinglock(m_pendingmutex);
 
-        this->beginRemoveRows(QModelIndex(), idx, idx);
-        m_items.removeAt(idx);
-        this->endRemoveRows();
+        if(!m_pendinginserted.remove(ldc->item))
+            m_pendingremoved.insert(ldc->item);
     }
     else if(ldc->isInserted())
     {
-        auto it = REDasm::Listing::insertionPoint(&m_items, ldc->item);
-        int idx = std::distance(m_items.begin(), it);
-
-        this->beginInsertRows(QModelIndex(), idx, idx);
-        m_items.insert(it, ldc->item);
-        this->endInsertRows();
+        std::lock_guard<std::mutex> pendinglock(m_pendingmutex);
+        m_pendinginserted.insert(ldc->item, ListingItemModel::listedItem(ldc->item));
     }
+    else
+        return;
+
+    this->schedulePending();
 }
@@ -1,7 +1,11 @@
 #ifndef LISTINGITEMMODEL_H
 #define LISTINGITEMMODEL_H
 
-#include <QList>
+#include <QTimer>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <mutex>
 #include "disassemblermodel.h"
 #include <redasm/disassembler/listing/listingdocument.h>
 
@@ -9,9 +13,14 @@ class ListingItemModel : public DisassemblerModel
 {
     Q_OBJECT
 
+    public:
+        struct ListedItem { REDasm::ListingItem* item; address_t address; size_t type; }; // Keys are captured while the item is alive
+
     public:
         explicit ListingItemModel(size_t itemtype, QObject *parent = NULL);
+        virtual ~ListingItemModel();
         virtual void setDisassembler(const REDasm::DisassemblerPtr &disassembler);
+        void setDeferredPopulation(bool b);
 
     public:
         virtual QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const;
@@ -19,16 +28,40 @@ class ListingItemModel : public DisassemblerModel
         virtual int columnCount(const QModelIndex& = QModelIndex()) const;
         virtual QVariant headerData(int section, Qt::Orientation orientation, int role) const;
         virtual QVariant data(const QModelIndex &index, int role) const;
+        virtual QString filterText(const ListedItem& item) const; // Thread safe, only 'item.address' and 'item.type' are read
 
     protected:
         virtual bool isItemAllowed(REDasm::ListingItem* item) const;
 
+    private slots:
+        void refreshRows();
+        void flushPending();
+
+    private:
+        struct CachedRow { QString address, name, references, segment; bool lockedfunction, string; };
+
     private:
+        static ListedItem listedItem(REDasm::ListingItem* item);
+        static bool itemLessThan(const ListedItem& item1, const ListedItem& item2);
+        bool isPendingRemoval(const REDasm::ListingItem* item) const;
+        void schedulePending();
+        int itemRow(const REDasm::ListingItem* item) const;
+        bool cachedRow(const ListedItem& item, CachedRow* row) const;
+        void invalidateRow(const REDasm::ListingItem* item);
+        void invalidateRows();
         void onListingChanged(const REDasm::ListingDocumentChanged *ldc);
 
     private:
-        QList<REDasm::ListingItem*> m_items;
+        QVector<ListedItem> m_items;
+        mutable QHash<const REDasm::ListingItem*, int> m_itemrows; // Built on demand, cleared when rows move
+        mutable QHash<const REDasm::ListingItem*, CachedRow> m_rows;
+        mutable std::mutex m_rowsmutex, m_pendingmutex;
+        QHash<REDasm::ListingItem*, ListedItem> m_pendinginserted;
+        QSet<REDasm::ListingItem*> m_pendingremoved;
+        QTimer* m_flushtimer;
+        u64 m_rowsgeneration;
         size_t m_itemtype;
+        bool m_flushscheduled, m_deferred;
 
     friend class ListingFilterModel;
 };
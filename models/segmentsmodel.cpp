@@ -1,5 +1,6 @@
 #include "segmentsmodel.h"
 #include <redasm/plugins/loader.h>
+#include <QStringList>
 #include <QColor>
 #include "../themeprovider.h"
 
@@ -81,6 +82,23 @@ QVariant SegmentsModel::headerData(int section, Qt::Orientation orientation, int
 
 int SegmentsModel::columnCount(const QModelIndex &) const { return 8; }
 
+QString SegmentsModel::filterText(const ListedItem &item) const
+{
+    const REDasm::AssemblerPlugin* assembler = m_disassembler->assembler();
+    const REDasm::Segment* segment = m_disassembler->document()->segment(item.address);
+
+    if(!segment)
+        return QString();
+
+    QStringList s;
+    s << S_TO_QS(REDasm::hex(segment->address, assembler->bits())) << S_TO_QS(REDasm::hex(segment->endaddress, assembler->bits()))
+      << S_TO_QS(REDasm::hex(segment->size(), assembler->bits())) << S_TO_QS(REDasm::hex(segment->offset, assembler->bits()))
+      << S_TO_QS(REDasm::hex(segment->endoffset, assembler->bits())) << S_TO_QS(REDasm::hex(segment->rawSize(), assembler->bits()))
+      << S_TO_QS(segment->name) << SegmentsModel::segmentFlags(segment);
+
+    return s.join('\n'); // Same columns as data()
+}
+
 QString SegmentsModel::segmentFlags(const REDasm::Segment *segment)
 {
     QString s;
@@ -0,0 +1,87 @@
+#include "trigramindex.h"
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+
+int TrigramIndex::size() const { return m_strings.size(); }
+void TrigramIndex::reserve(int count) { m_strings.reserve(count); }
+
+void TrigramIndex::clear()
+{
+    m_strings.clear();
+    m_postings.clear();
+}
+
+int TrigramIndex::add(const QString &s)
+{
+    int row = m_strings.size();
+    m_strings.append(s.toLower());
+
+    const QString& ls = m_strings.last();
+
+    for(int i = 0; (i + 2) < ls.size(); i++)
+    {
+        QVector<int>& rows = m_postings[TrigramIndex::trigram(ls.constData() + i)];
+
+        if(rows.empty() || (rows.last() != row)) // Rows are added in order, skip repeated trigrams
+            rows.append(row);
+    }
+
+    return row;
+}
+
+QVector<int> TrigramIndex::candidates(const QString &s) const
+{
+    QString ls = s.toLower();
+    QVector<int> rows;
+
+    if(ls.size() < 3) // Too short for trigrams, every row must be checked
+    {
+        rows.resize(m_strings.size());
+        std::iota(rows.begin(), rows.end(), 0);
+        return rows;
+    }
+
+    QVector<const QVector<int>*> postings;
+
+    for(int i = 0; (i + 2) < ls.size(); i++)
+    {
+        auto it = m_postings.find(TrigramIndex::trigram(ls.constData() + i));
+
+        if(it == m_postings.end())
+            return rows;
+
+        postings.append(&it.value());
+    }
+
+    // Intersect starting from the rarest trigram
+    std::sort(postings.begin(), postings.end(), [](const QVector<int>* p1, const QVector<int>* p2) { return p1->size() < p2->size(); });
+    rows = *postings.first();
+
+    for(int i = 1; (i < postings.size()) && !rows.empty(); i++)
+    {
+        QVector<int> intersection;
+        std::set_intersection(rows.begin(), rows.end(), postings[i]->begin(), postings[i]->end(), std::back_inserter(intersection));
+        rows.swap(intersection);
+    }
+
+    return rows;
+}
+
+QVector<int> TrigramIndex::find(const QString &s) const { return this->refine(this->candidates(s), s); } // Trigrams can match in a different order
+
+QVector<int> TrigramIndex::refine(const QVector<int> &rows, const QString &s) const
+{
+    QString ls = s.toLower();
+    QVector<int> result;
+
+    for(int row : rows)
+    {
+        if(m_strings[row].contains(ls))
+            result.append(row);
+    }
+
+    return result;
+}
+
+quint64 TrigramIndex::trigram(const QChar *s) { return (static_cast<quint64>(s[0].unicode()) << 32) | (static_cast<quint64>(s[1].unicode()) << 16) | s[2].unicode(); }
@@ -0,0 +1,28 @@
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include <QVector>
+#include <QString>
+#include <QHash>
+
+class TrigramIndex
+{
+    public:
+        TrigramIndex() = default;
+        int size() const;
+        void clear();
+        void reserve(int count);
+        int add(const QString& s);
+        QVector<int> candidates(const QString& s) const;
+        QVector<int> find(const QString& s) const;
+        QVector<int> refine(const QVector<int>& rows, const QString& s) const;
+
+    private:
+        static quint64 trigram(const QChar* s);
+
+    private:
+        QVector<QString> m_strings; // Lowercase
+        QHash<quint64, QVector<int> > m_postings;
+};
+
+#endif // TRIGRAMINDEX_H
@@ -57,6 +57,8 @@ int REDasmSettings::currentFontSize() const
     return this->value("selected_font_size", size).toInt();
 }
 
+bool REDasmSettings::entropyOverlay() const { return this->value("entropy_overlay", false).toBool(); }
 void REDasmSettings::changeTheme(const QString& theme) { this->setValue("selected_theme", theme.toLower()); }
 void REDasmSettings::changeFont(const QFont &font) { this->setValue("selected_font", font);  }
 void REDasmSettings::changeFontSize(int size) { this->setValue("selected_font_size", size); }
+void REDasmSettings::changeEntropyOverlay(bool b) { this->setValue("entropy_overlay", b); }
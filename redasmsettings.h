@@ -16,6 +16,7 @@ class REDasmSettings : public QSettings
         QString currentTheme() const;
         QFont currentFont() const;
         int currentFontSize() const;
+        bool entropyOverlay() const;
         bool restoreState(QMainWindow* mainwindow);
         void defaultState(QMainWindow* mainwindow);
         void saveState(const QMainWindow* mainwindow);
@@ -23,6 +24,7 @@ class REDasmSettings : public QSettings
         void changeTheme(const QString& theme);
         void changeFont(const QFont &font);
         void changeFontSize(int size);
+        void changeEntropyOverlay(bool b);
 
     private:
         static QByteArray m_defaultstate;
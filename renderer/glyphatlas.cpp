@@ -0,0 +1,106 @@
+#include "glyphatlas.h"
+#include <QPaintDevice>
+#include <QFontMetrics>
+#include <QFontInfo>
+#include <cmath>
+
+#define GLYPH_FIRST ' '
+#define GLYPH_LAST  '~'
+#define GLYPH_COUNT ((GLYPH_LAST - GLYPH_FIRST) + 1)
+
+GlyphAtlas::GlyphAtlas(const QFont &font): m_font(font), m_fontmetrics(font), m_dpr(1.0)
+{
+    m_advance = m_fontmetrics.width(' ');
+    m_cellwidth = std::ceil(m_advance) + 1; // Keep one pixel between cells in order to avoid bleeding
+    m_cellheight = QFontMetrics(font).height(); // Integral line pitch, matches widgets' line geometry
+
+    // QFontInfo::fixedPitch() is not reliable on every platform, check some advances too
+    m_monospace = QFontInfo(font).fixedPitch() && qFuzzyCompare(m_fontmetrics.width('i'), m_advance) &&
+                                                  qFuzzyCompare(m_fontmetrics.width('W'), m_advance);
+}
+
+const QFont &GlyphAtlas::font() const { return m_font; }
+const QFontMetricsF &GlyphAtlas::fontMetrics() const { return m_fontmetrics; }
+bool GlyphAtlas::isMonospace() const { return m_monospace; }
+qreal GlyphAtlas::advance() const { return m_advance; }
+qreal GlyphAtlas::lineHeight() const { return m_cellheight; }
+
+qreal GlyphAtlas::textWidth(const std::string &s) const
+{
+    if(m_monospace && GlyphAtlas::isPrintable(s))
+        return s.size() * m_advance;
+
+    return m_fontmetrics.width(QString::fromStdString(s));
+}
+
+qreal GlyphAtlas::drawText(QPainter *painter, qreal x, qreal y, const std::string &s, const QColor &color)
+{
+    if(s.empty())
+        return 0;
+
+    if(!m_monospace || !GlyphAtlas::isPrintable(s)) // Fallback to Qt's text engine
+    {
+        QString qs = QString::fromStdString(s);
+        painter->setPen(color);
+        painter->drawText(QPointF(x, y + m_fontmetrics.ascent()), qs);
+        return m_fontmetrics.width(qs);
+    }
+
+    qreal dpr = painter->device()->devicePixelRatioF();
+    const QPixmap& pixmap = this->glyphs(color, dpr);
+    m_fragments.resize(0);
+
+    for(size_t i = 0; i < s.size(); i++)
+    {
+        if(s[i] == ' ')
+            continue;
+
+        QRectF sourcerect((s[i] - GLYPH_FIRST) * m_cellwidth * dpr, 0, m_cellwidth * dpr, m_cellheight * dpr);
+        QPointF center(x + (i * m_advance) + (m_cellwidth / 2), y + (m_cellheight / 2));
+        m_fragments.append(QPainter::PixmapFragment::create(center, sourcerect, 1 / dpr, 1 / dpr));
+    }
+
+    if(!m_fragments.empty())
+        painter->drawPixmapFragments(m_fragments.constData(), m_fragments.size(), pixmap);
+
+    return s.size() * m_advance;
+}
+
+bool GlyphAtlas::isPrintable(const std::string &s)
+{
+    for(char ch : s)
+    {
+        if((ch < GLYPH_FIRST) || (ch > GLYPH_LAST))
+            return false;
+    }
+
+    return true;
+}
+
+const QPixmap &GlyphAtlas::glyphs(const QColor &color, qreal dpr)
+{
+    if(!qFuzzyCompare(dpr, m_dpr)) // Screen changed, glyphs must be rasterized again
+    {
+        m_glyphs.clear();
+        m_dpr = dpr;
+    }
+
+    auto it = m_glyphs.find(color.rgba());
+
+    if(it != m_glyphs.end())
+        return it->second;
+
+    QPixmap pixmap(std::ceil(GLYPH_COUNT * m_cellwidth * dpr), std::ceil(m_cellheight * dpr));
+    pixmap.setDevicePixelRatio(dpr);
+    pixmap.fill(Qt::transparent);
+
+    QPainter painter(&pixmap);
+    painter.setFont(m_font);
+    painter.setPen(color);
+
+    for(int i = 0; i < GLYPH_COUNT; i++)
+        painter.drawText(QPointF(i * m_cellwidth, m_fontmetrics.ascent()), QString(QChar(GLYPH_FIRST + i)));
+
+    painter.end();
+    return m_glyphs.emplace(color.rgba(), pixmap).first->second;
+}
@@ -0,0 +1,38 @@
+#ifndef GLYPHATLAS_H
+#define GLYPHATLAS_H
+
+#include <unordered_map>
+#include <string>
+#include <QFontMetricsF>
+#include <QPainter>
+#include <QPixmap>
+#include <QVector>
+#include <QColor>
+#include <QFont>
+
+class GlyphAtlas
+{
+    public:
+        GlyphAtlas(const QFont& font);
+        const QFont& font() const;
+        const QFontMetricsF& fontMetrics() const;
+        bool isMonospace() const;
+        qreal advance() const;
+        qreal lineHeight() const;
+        qreal textWidth(const std::string& s) const;
+        qreal drawText(QPainter* painter, qreal x, qreal y, const std::string& s, const QColor& color);
+
+    private:
+        static bool isPrintable(const std::string& s);
+        const QPixmap& glyphs(const QColor& color, qreal dpr);
+
+    private:
+        QFont m_font;
+        QFontMetricsF m_fontmetrics;
+        std::unordered_map<QRgb, QPixmap> m_glyphs;
+        QVector<QPainter::PixmapFragment> m_fragments;
+        qreal m_advance, m_cellwidth, m_cellheight, m_dpr;
+        bool m_monospace;
+};
+
+#endif // GLYPHATLAS_H
@@ -1,7 +1,58 @@
 #include "listinggraphrenderer.h"
 #include "listingrenderercommon.h"
+#include <algorithm>
 
-ListingGraphRenderer::ListingGraphRenderer(REDasm::DisassemblerAPI *disassembler): ListingPopupRenderer(disassembler)
+ListingGraphRenderer::ListingGraphRenderer(const QFont &font, REDasm::DisassemblerAPI *disassembler): REDasm::ListingRenderer(disassembler), m_glyphatlas(font)
 {
     this->setFlags(ListingGraphRenderer::HideSegmentName);
 }
+
+const QFont &ListingGraphRenderer::font() const { return m_glyphatlas.font(); }
+qreal ListingGraphRenderer::lineHeight() const { return m_glyphatlas.lineHeight(); }
+
+qreal ListingGraphRenderer::textWidth(const Lines &lines) const
+{
+    qreal width = 0;
+
+    for(const REDasm::RendererLine& rl : lines)
+        width = std::max(width, m_glyphatlas.textWidth(rl.text));
+
+    return width;
+}
+
+void ListingGraphRenderer::renderLines(u64 first, u64 count, Lines &lines)
+{
+    lines.clear();
+    lines.reserve(count);
+
+    // render() bakes cursor and selection formats in, blocks are cached and painted later
+    for(u64 i = 0; i < count; i++)
+    {
+        REDasm::RendererLine rl;
+
+        if(!this->getRendererLine(first + i, rl))
+            continue;
+
+        rl.documentindex = first + i;
+        lines.push_back(rl);
+    }
+}
+
+void ListingGraphRenderer::paintLines(QPainter *painter, const Lines &lines, qreal width)
+{
+    m_highlighter.setWord(m_cursor->wordUnderCursor());
+    qreal y = 0;
+
+    for(const REDasm::RendererLine& rl : lines)
+    {
+        if(m_cursor->currentLine() == rl.documentindex)
+            painter->fillRect(QRectF(0, y, width, m_glyphatlas.lineHeight()), ListingRendererCommon::styleColor("seek"));
+
+        m_highlighter.find(rl.text, m_spans);
+        ListingRendererCommon::renderText(painter, rl, 0, y, &m_glyphatlas);
+        ListingRendererCommon::renderDecorations(painter, rl, m_spans, m_cursor, y, &m_glyphatlas);
+        y += m_glyphatlas.lineHeight();
+    }
+}
+
+void ListingGraphRenderer::renderLine(const REDasm::RendererLine &rl) { static_cast<Lines*>(rl.userdata)->push_back(rl); }
@@ -1,12 +1,32 @@
 #ifndef LISTINGGRAPHRENDERER_H
 #define LISTINGGRAPHRENDERER_H
 
-#include "listingpopuprenderer.h"
+#include <QPainter>
+#include <QFont>
+#include <redasm/disassembler/listing/listingrenderer.h>
+#include "wordhighlighter.h"
+#include "glyphatlas.h"
 
-class ListingGraphRenderer: public ListingPopupRenderer
+class ListingGraphRenderer: public REDasm::ListingRenderer
 {
     public:
-        ListingGraphRenderer(REDasm::DisassemblerAPI* disassembler);
+        typedef std::vector<REDasm::RendererLine> Lines;
+
+    public:
+        ListingGraphRenderer(const QFont& font, REDasm::DisassemblerAPI* disassembler);
+        const QFont& font() const;
+        qreal lineHeight() const;
+        qreal textWidth(const Lines& lines) const;
+        void renderLines(u64 first, u64 count, Lines& lines);                // Never reads the cursor, safe off the GUI thread
+        void paintLines(QPainter* painter, const Lines& lines, qreal width); // GUI thread only, cursor and word are applied here
+
+    protected:
+        virtual void renderLine(const REDasm::RendererLine& rl);
+
+    private:
+        GlyphAtlas m_glyphatlas;
+        WordHighlighter m_highlighter;
+        WordHighlighter::Spans m_spans;
 };
 
 #endif // LISTINGGRAPHRENDERER_H
@@ -15,7 +15,11 @@ void ListingPopupRenderer::renderLine(const REDasm::RendererLine &rl)
 {
     QTextDocument* textdocument = static_cast<QTextDocument*>(rl.userdata);
     QFontMetrics fm(textdocument->defaultFont());
-    ListingRendererCommon lrc(textdocument, m_document);
+
+    if(!rl.index) // New render pass
+        m_highlighter.setWord(m_cursor->wordUnderCursor());
+
+    ListingRendererCommon lrc(textdocument, m_document, &m_highlighter);
 
     if(rl.index > 0)
     {
@@ -4,6 +4,7 @@
 #include <QTextOption>
 #include <QFont>
 #include <redasm/disassembler/listing/listingrenderer.h>
+#include "wordhighlighter.h"
 
 class ListingPopupRenderer: public REDasm::ListingRenderer
 {
@@ -16,6 +17,7 @@ class ListingPopupRenderer: public REDasm::ListingRenderer
         virtual void renderLine(const REDasm::RendererLine& rl);
 
     private:
+        WordHighlighter m_highlighter;
         int m_maxwidth;
 };
 
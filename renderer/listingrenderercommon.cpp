@@ -1,11 +1,12 @@
 ﻿#include "listingrenderercommon.h"
 #include "../themeprovider.h"
+#include <unordered_map>
 #include <QGuiApplication>
 #include <QTextCharFormat>
 #include <QPalette>
 #include <QPainter>
 
-ListingRendererCommon::ListingRendererCommon(QTextDocument *textdocument, REDasm::ListingDocument& document): m_textdocument(textdocument), m_document(document)
+ListingRendererCommon::ListingRendererCommon(QTextDocument *textdocument, REDasm::ListingDocument& document, const WordHighlighter *highlighter): m_textdocument(textdocument), m_document(document), m_highlighter(highlighter)
 {
     m_rgxwords.setPattern(REDASM_WORD_REGEX);
     m_textcursor = QTextCursor(textdocument);
@@ -47,46 +48,108 @@ void ListingRendererCommon::insertText(const REDasm::RendererLine &rl, bool show
     }
 }
 
-void ListingRendererCommon::renderText(const REDasm::RendererLine &rl, float x, float y, const QFontMetricsF& fm)
+void ListingRendererCommon::renderText(QPainter *painter, const REDasm::RendererLine &rl, float x, float y, GlyphAtlas *glyphatlas)
 {
-    QPainter* painter = reinterpret_cast<QPainter*>(rl.userdata);
-
-    if(rl.highlighted)
-    {
-        QRect vpr = painter->viewport();
-        painter->fillRect(0, y, vpr.width(), fm.height(), THEME_VALUE("seek"));
-    }
+    qreal lineheight = glyphatlas->lineHeight();
 
     for(const REDasm::RendererFormat& rf : rl.formats)
     {
+        QColor fgcolor;
+
         if(!rf.fgstyle.empty())
         {
             if((rf.fgstyle == "cursor_fg") || (rf.fgstyle == "selection_fg"))
-                painter->setPen(qApp->palette().color(QPalette::HighlightedText));
+                fgcolor = qApp->palette().color(QPalette::HighlightedText);
             else
-                painter->setPen(THEME_VALUE(QString::fromStdString(rf.fgstyle)));
+                fgcolor = ListingRendererCommon::styleColor(rf.fgstyle);
         }
         else
-            painter->setPen(qApp->palette().color(QPalette::WindowText));
+            fgcolor = qApp->palette().color(QPalette::WindowText);
 
-        QString chunk = QString::fromStdString(rl.formatText(rf));
-        QRectF chunkrect = painter->boundingRect(QRectF(x, y, fm.width(chunk), fm.height()), Qt::TextIncludeTrailingSpaces, chunk);
+        std::string chunk = rl.formatText(rf);
 
         if(!rf.bgstyle.empty())
         {
+            QRectF chunkrect(x, y, glyphatlas->textWidth(chunk), lineheight);
+
             if(rf.bgstyle == "cursor_bg")
                 painter->fillRect(chunkrect, qApp->palette().color(QPalette::WindowText));
             else if(rf.bgstyle == "selection_bg")
                 painter->fillRect(chunkrect, qApp->palette().color(QPalette::Highlight));
             else
-                painter->fillRect(chunkrect, THEME_VALUE(QString::fromStdString(rf.bgstyle)));
+                painter->fillRect(chunkrect, ListingRendererCommon::styleColor(rf.bgstyle));
+        }
+
+        x += glyphatlas->drawText(painter, x, y, chunk, fgcolor);
+    }
+}
+
+void ListingRendererCommon::renderOverlay(QPainter *painter, const REDasm::RendererLine &rl, u64 start, u64 end, float y, const QColor &bg, const QColor &fg, GlyphAtlas *glyphatlas)
+{
+    if(start > end)
+        return;
+
+    const std::string& text = rl.text;
+    std::string chunk;
+    qreal x = 0;
+
+    if(start < text.size())
+    {
+        chunk = text.substr(start, std::min(end, static_cast<u64>(text.size() - 1)) - start + 1);
+        x = glyphatlas->textWidth(text.substr(0, start));
+    }
+    else // Past the end of line (eg. cursor on an empty line)
+    {
+        chunk = " ";
+        x = glyphatlas->textWidth(text) + ((start - text.size()) * glyphatlas->advance());
+    }
+
+    painter->fillRect(QRectF(x, y, glyphatlas->textWidth(chunk), glyphatlas->lineHeight()), bg);
+    glyphatlas->drawText(painter, x, y, chunk, fg);
+}
+
+void ListingRendererCommon::renderDecorations(QPainter *painter, const REDasm::RendererLine &rl, const WordHighlighter::Spans &spans, REDasm::ListingCursor *cursor, float y, GlyphAtlas *glyphatlas)
+{
+    // Cursor and selection are painted over formatted lines, so they never invalidate them
+    QPalette palette = qApp->palette();
+
+    if(cursor->isLineSelected(rl.documentindex))
+    {
+        const REDasm::ListingCursor::Position& startsel = cursor->startSelection();
+        const REDasm::ListingCursor::Position& endsel = cursor->endSelection();
+        u64 start = (rl.documentindex == startsel.first) ? startsel.second : 0;
+        u64 end = (rl.documentindex == endsel.first) ? endsel.second : rl.text.size() - 1;
+
+        ListingRendererCommon::renderOverlay(painter, rl, start, end, y, palette.color(QPalette::Highlight),
+                                             palette.color(QPalette::HighlightedText), glyphatlas);
+    }
+    else
+    {
+        for(const WordHighlighter::Span& span : spans)
+        {
+            ListingRendererCommon::renderOverlay(painter, rl, span.start, span.start + span.length - 1, y, ListingRendererCommon::styleColor("highlight_bg"),
+                                                 ListingRendererCommon::styleColor("highlight_fg"), glyphatlas);
         }
+    }
 
-        painter->drawText(chunkrect, Qt::TextSingleLine, chunk);
-        x += chunkrect.width();
+    if((cursor->currentLine() == rl.documentindex) && cursor->active())
+    {
+        ListingRendererCommon::renderOverlay(painter, rl, cursor->currentColumn(), cursor->currentColumn(), y,
+                                             palette.color(QPalette::WindowText), palette.color(QPalette::HighlightedText), glyphatlas);
     }
 }
 
+const QColor &ListingRendererCommon::styleColor(const std::string &style)
+{
+    static std::unordered_map<std::string, QColor> colors; // Themes cannot be changed at runtime
+    auto it = colors.find(style);
+
+    if(it != colors.end())
+        return it->second;
+
+    return colors.emplace(style, THEME_VALUE(QString::fromStdString(style))).first->second;
+}
+
 QString ListingRendererCommon::foregroundHtml(const std::string &s, const std::string& style, const REDasm::RendererLine& rl) const
 {
     QColor c = THEME_VALUE(QString::fromStdString(style));
@@ -147,22 +210,28 @@ void ListingRendererCommon::highlightSelection(const REDasm::RendererLine &rl)
 
 void ListingRendererCommon::highlightWords(const REDasm::RendererLine &rl)
 {
-    if(m_document->cursor()->wordUnderCursor().empty())
+    WordHighlighter::Spans spans;
+
+    if(m_highlighter)
+        m_highlighter->find(rl.text, spans);
+    else // No render pass, search the word directly
+    {
+        WordHighlighter highlighter;
+        highlighter.setWord(m_document->cursor()->wordUnderCursor());
+        highlighter.find(rl.text, spans);
+    }
+
+    if(spans.empty())
         return;
 
     QTextCharFormat charformat;
-    charformat.setBackground(THEME_VALUE("highlight_bg"));
-    charformat.setForeground(THEME_VALUE("highlight_fg"));
+    charformat.setBackground(ListingRendererCommon::styleColor("highlight_bg"));
+    charformat.setForeground(ListingRendererCommon::styleColor("highlight_fg"));
 
-    QRegularExpression rgx(QRegularExpression::escape(QString::fromStdString(m_document->cursor()->wordUnderCursor())));
-    QRegularExpressionMatchIterator it = rgx.globalMatch(QString::fromStdString(rl.text));
-
-    while(it.hasNext())
+    for(const WordHighlighter::Span& span : spans)
     {
-        QRegularExpressionMatch match = it.next();
-
-        m_textcursor.setPosition(match.capturedStart());
-        m_textcursor.movePosition(QTextCursor::Right, QTextCursor::KeepAnchor, match.capturedLength());
+        m_textcursor.setPosition(span.start);
+        m_textcursor.movePosition(QTextCursor::Right, QTextCursor::KeepAnchor, span.length);
         m_textcursor.setCharFormat(charformat);
     }
 }
@@ -2,21 +2,25 @@
 #define LISTINGRENDERERCOMMON_H
 
 #include <QRegularExpression>
-#include <QFontMetricsF>
 #include <QTextDocument>
 #include <QTextCursor>
 #include <redasm/disassembler/listing/listingdocument.h>
 #include <redasm/disassembler/listing/listingrenderer.h>
+#include "wordhighlighter.h"
+#include "glyphatlas.h"
 
 class ListingRendererCommon
 {
     public:
-        ListingRendererCommon(QTextDocument* textdocument, REDasm::ListingDocument& document);
+        ListingRendererCommon(QTextDocument* textdocument, REDasm::ListingDocument& document, const WordHighlighter* highlighter = nullptr);
         void insertLine(const REDasm::RendererLine& rl, bool showcursor = false);
         void insertText(const REDasm::RendererLine& rl, bool showcursor = false);
 
     public:
-        static void renderText(const REDasm::RendererLine& rl, float x, float y, const QFontMetricsF &fm);
+        static void renderText(QPainter* painter, const REDasm::RendererLine& rl, float x, float y, GlyphAtlas* glyphatlas);
+        static void renderOverlay(QPainter* painter, const REDasm::RendererLine& rl, u64 start, u64 end, float y, const QColor& bg, const QColor& fg, GlyphAtlas* glyphatlas);
+        static void renderDecorations(QPainter* painter, const REDasm::RendererLine& rl, const WordHighlighter::Spans& spans, REDasm::ListingCursor* cursor, float y, GlyphAtlas* glyphatlas);
+        static const QColor& styleColor(const std::string& style);
 
     private:
         QString foregroundHtml(const std::string& s, const std::string& style, const REDasm::RendererLine &rl) const;
@@ -31,6 +35,7 @@ class ListingRendererCommon
     private:
         QTextDocument* m_textdocument;
         REDasm::ListingDocument& m_document;
+        const WordHighlighter* m_highlighter;
         QTextCursor m_textcursor;
         QRegularExpression m_rgxwords;
 };
@@ -1,6 +1,7 @@
 #include "listingtextrenderer.h"
 #include "listingrenderercommon.h"
 #include "../themeprovider.h"
+#include <algorithm>
 #include <cmath>
 #include <QApplication>
 #include <QTextCharFormat>
@@ -8,41 +9,54 @@
 #include <QPalette>
 #include <QPainter>
 
-ListingTextRenderer::ListingTextRenderer(const QFont &font, REDasm::DisassemblerAPI *disassembler): REDasm::ListingRenderer(disassembler), m_fontmetrics(font), m_firstline(0) { m_maxwidth = 0; }
-int ListingTextRenderer::lineHeight() const { return m_fontmetrics.height(); }
+#define LINE_CACHE_SIZE 1024
+
+ListingTextRenderer::ListingTextRenderer(const QFont &font, REDasm::DisassemblerAPI *disassembler): REDasm::ListingRenderer(disassembler), m_glyphatlas(font), m_linecache(LINE_CACHE_SIZE), m_fontmetrics(font), m_firstline(0) { m_maxwidth = 0; }
+int ListingTextRenderer::lineHeight() const { return m_glyphatlas.lineHeight(); }
 int ListingTextRenderer::maxWidth() const { return m_maxwidth; }
 void ListingTextRenderer::setFirstVisibleLine(u64 line) { m_firstline = line; }
 
-REDasm::ListingCursor::Position ListingTextRenderer::hitTest(const QPointF &pos, int firstline)
+void ListingTextRenderer::renderLines(u64 first, u64 count, QPainter *painter)
 {
-    REDasm::ListingCursor::Position cp;
-    cp.first = std::min(static_cast<u64>(firstline + std::floor(pos.y() / m_fontmetrics.height())), m_document->lastLine());
-    cp.second = std::numeric_limits<u64>::max();
+    auto lock = REDasm::s_lock_safe_ptr(m_document);
+    u64 last = std::min(first + count, static_cast<u64>(lock->length()));
+    m_lines.clear();
 
-    REDasm::RendererLine rl;
+    for(u64 line = first; line < last; line++)
+    {
+        const REDasm::RendererLine* rl = this->cachedLine(line, lock->itemAt(line));
 
-    if(!this->getRendererLine(cp.first, rl))
-        cp.second = 0;
+        if(rl)
+            m_lines.push_back(rl);
+    }
 
-    std::string s = rl.text;
-    qreal x = 0;
+    m_highlighter.setWord(m_cursor->wordUnderCursor());
+    m_highlighter.findAll(m_lines);
 
-    for(size_t i = 0; i < s.length(); i++)
+    for(size_t i = 0; i < m_lines.size(); i++)
     {
-        qreal w = m_fontmetrics.width(s[i]);
-
-        if(x >= pos.x())
-        {
-            cp.second = i - 1;
-            break;
-        }
-
-        x += w;
+        const REDasm::RendererLine* rl = m_lines[i];
+        m_maxwidth = i ? std::max(m_maxwidth, m_glyphatlas.textWidth(rl->text)) : m_glyphatlas.textWidth(rl->text);
+        this->paintLine(*rl, m_highlighter.spans(i), painter);
     }
+}
 
-    if(cp.second == std::numeric_limits<u64>::max())
-        cp.second = static_cast<u64>(s.length() - 1);
+void ListingTextRenderer::invalidate(const REDasm::ListingDocumentChanged *ldc)
+{
+    if(ldc->item->is(REDasm::ListingItem::InstructionItem) && !ldc->isRemoved())
+        m_linecache.invalidate(ldc->item);
+    else
+        m_linecache.invalidate(); // Symbols can change the output of every line that references them, removed items must not keep a revision
+}
+
+REDasm::ListingCursor::Position ListingTextRenderer::hitTest(const QPointF &pos, int firstline)
+{
+    auto lock = REDasm::s_lock_safe_ptr(m_document);
+    REDasm::ListingCursor::Position cp;
+    cp.first = std::min(static_cast<u64>(firstline + std::floor(pos.y() / m_glyphatlas.lineHeight())), lock->lastLine());
 
+    const REDasm::RendererLine* rl = this->cachedLine(cp.first, lock->itemAt(cp.first));
+    cp.second = (rl && !rl->text.empty()) ? this->columnAt(*rl, pos.x()) : 0;
     return cp;
 }
 
@@ -65,10 +79,73 @@ void ListingTextRenderer::highlightWordUnderCursor() { m_cursor->setWordUnderCur
 void ListingTextRenderer::renderLine(const REDasm::RendererLine &rl)
 {
     if(rl.index > 0)
-        m_maxwidth = std::max(m_maxwidth, m_fontmetrics.boundingRect(QString::fromStdString(rl.text)).width());
+        m_maxwidth = std::max(m_maxwidth, m_glyphatlas.textWidth(rl.text));
     else
-        m_maxwidth = m_fontmetrics.boundingRect(QString::fromStdString(rl.text)).width();
+        m_maxwidth = m_glyphatlas.textWidth(rl.text);
+
+    m_highlighter.setWord(m_cursor->wordUnderCursor());
+    m_highlighter.find(rl.text, m_spans);
+    this->paintLine(rl, m_spans, reinterpret_cast<QPainter*>(rl.userdata));
+}
+
+const REDasm::RendererLine *ListingTextRenderer::cachedLine(u64 line, const REDasm::ListingItem *item)
+{
+    if(!item)
+        return nullptr;
+
+    const REDasm::RendererLine* rl = m_linecache.line(line, item);
+
+    if(rl)
+        return rl;
+
+    RendererLineCache::Stamp stamp = m_linecache.stamp(item); // Take it before formatting, changes may happen meanwhile
+    REDasm::RendererLine newrl;
+
+    if(!this->getRendererLine(line, newrl))
+        return nullptr;
+
+    newrl.documentindex = line;
+    return m_linecache.insert(line, item, stamp, newrl);
+}
+
+u64 ListingTextRenderer::columnAt(const REDasm::RendererLine &rl, qreal x)
+{
+    u64 lastcolumn = rl.text.size() - 1;
+
+    if(x <= 0)
+        return 0;
+
+    if(m_glyphatlas.isMonospace())
+        return std::min(static_cast<u64>(x / m_glyphatlas.advance()), lastcolumn);
+
+    std::vector<qreal>* advances = m_linecache.advances(rl.documentindex);
+
+    if(advances->empty())
+    {
+        qreal w = 0;
+        advances->reserve(rl.text.size());
+
+        for(char ch : rl.text)
+        {
+            w += m_fontmetrics.width(QChar(ch));
+            advances->push_back(w); // Right edge of each column
+        }
+    }
+
+    auto it = std::upper_bound(advances->begin(), advances->end(), x);
+    return std::min(static_cast<u64>(std::distance(advances->begin(), it)), lastcolumn);
+}
+
+void ListingTextRenderer::paintLine(const REDasm::RendererLine &rl, const WordHighlighter::Spans &spans, QPainter *painter)
+{
+    qreal y = (rl.documentindex - m_firstline) * m_glyphatlas.lineHeight();
+
+    if(m_cursor->currentLine() == rl.documentindex)
+    {
+        QRect vpr = painter->viewport();
+        painter->fillRect(QRectF(0, y, vpr.width(), m_glyphatlas.lineHeight()), ListingRendererCommon::styleColor("seek"));
+    }
 
-    int y = (rl.documentindex - m_firstline) * m_fontmetrics.height();
-    ListingRendererCommon::renderText(rl, 0, y, m_fontmetrics);
+    ListingRendererCommon::renderText(painter, rl, 0, y, &m_glyphatlas);
+    ListingRendererCommon::renderDecorations(painter, rl, spans, m_cursor, y, &m_glyphatlas);
 }
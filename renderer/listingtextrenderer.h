@@ -4,8 +4,12 @@
 #include <QRegularExpression>
 #include <QTextOption>
 #include <QFontMetrics>
+#include <QPainter>
 #include <QFont>
 #include <redasm/disassembler/listing/listingrenderer.h>
+#include "rendererlinecache.h"
+#include "wordhighlighter.h"
+#include "glyphatlas.h"
 
 class ListingTextRenderer: public REDasm::ListingRenderer
 {
@@ -18,6 +22,8 @@ class ListingTextRenderer: public REDasm::ListingRenderer
         int lineHeight() const;
         int maxWidth() const;
         void setFirstVisibleLine(u64 line);
+        void renderLines(u64 first, u64 count, QPainter* painter);
+        void invalidate(const REDasm::ListingDocumentChanged* ldc);
 
     public:
         REDasm::ListingCursor::Position hitTest(const QPointF& pos, int firstline);
@@ -29,6 +35,16 @@ class ListingTextRenderer: public REDasm::ListingRenderer
         virtual void renderLine(const REDasm::RendererLine& rl);
 
     private:
+        const REDasm::RendererLine* cachedLine(u64 line, const REDasm::ListingItem* item);
+        u64 columnAt(const REDasm::RendererLine& rl, qreal x);
+        void paintLine(const REDasm::RendererLine& rl, const WordHighlighter::Spans& spans, QPainter* painter);
+
+    private:
+        GlyphAtlas m_glyphatlas;
+        RendererLineCache m_linecache;
+        WordHighlighter m_highlighter;
+        WordHighlighter::Spans m_spans;
+        std::vector<const REDasm::RendererLine*> m_lines;
         QFontMetricsF m_fontmetrics;
         u64 m_firstline;
         qreal m_maxwidth;
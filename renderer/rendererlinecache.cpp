@@ -0,0 +1,80 @@
+#include "rendererlinecache.h"
+
+RendererLineCache::RendererLineCache(size_t capacity): m_generation(0), m_capacity(capacity) { }
+
+RendererLineCache::Stamp RendererLineCache::stamp(const REDasm::ListingItem *item)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_revisions.find(item);
+    return { m_generation.load(), (it != m_revisions.end()) ? it->second : 0 };
+}
+
+const REDasm::RendererLine *RendererLineCache::line(u64 index, const REDasm::ListingItem *item)
+{
+    auto it = m_index.find(index);
+
+    if(it == m_index.end())
+        return nullptr;
+
+    const CachedLine& cl = *it->second;
+    Stamp stamp = this->stamp(item);
+
+    if((cl.item != item) || (cl.stamp.generation != stamp.generation) || (cl.stamp.revision != stamp.revision))
+    {
+        this->erase(index);
+        return nullptr;
+    }
+
+    m_lines.splice(m_lines.begin(), m_lines, it->second); // Most recently used
+    return &cl.line;
+}
+
+const REDasm::RendererLine *RendererLineCache::insert(u64 index, const REDasm::ListingItem *item, const Stamp &stamp, const REDasm::RendererLine &rl)
+{
+    this->erase(index);
+
+    m_lines.push_front({ index, item, stamp, rl, { } });
+    m_index[index] = m_lines.begin();
+
+    while(m_lines.size() > m_capacity)
+    {
+        m_index.erase(m_lines.back().index);
+        m_lines.pop_back();
+    }
+
+    return &m_lines.front().line;
+}
+
+std::vector<qreal> *RendererLineCache::advances(u64 index)
+{
+    auto it = m_index.find(index);
+
+    if(it == m_index.end())
+        return nullptr;
+
+    return &it->second->advances;
+}
+
+void RendererLineCache::invalidate(const REDasm::ListingItem *item)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_revisions[item]++;
+}
+
+void RendererLineCache::invalidate()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_generation++;
+    m_revisions.clear(); // Every cached line is stale now, revisions can start over
+}
+
+void RendererLineCache::erase(u64 index)
+{
+    auto it = m_index.find(index);
+
+    if(it == m_index.end())
+        return;
+
+    m_lines.erase(it->second);
+    m_index.erase(it);
+}
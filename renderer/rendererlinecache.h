@@ -0,0 +1,43 @@
+#ifndef RENDERERLINECACHE_H
+#define RENDERERLINECACHE_H
+
+#include <unordered_map>
+#include <atomic>
+#include <vector>
+#include <mutex>
+#include <list>
+#include <QtGlobal>
+#include <redasm/disassembler/listing/listingdocument.h>
+#include <redasm/disassembler/listing/listingrenderer.h>
+
+class RendererLineCache
+{
+    public:
+        struct Stamp { u64 generation, revision; };
+
+    private:
+        struct CachedLine { u64 index; const REDasm::ListingItem* item; Stamp stamp; REDasm::RendererLine line; std::vector<qreal> advances; };
+        typedef std::list<CachedLine> CachedLines;
+
+    public:
+        RendererLineCache(size_t capacity);
+        Stamp stamp(const REDasm::ListingItem* item);
+        const REDasm::RendererLine* line(u64 index, const REDasm::ListingItem* item);
+        const REDasm::RendererLine* insert(u64 index, const REDasm::ListingItem* item, const Stamp& stamp, const REDasm::RendererLine& rl);
+        std::vector<qreal>* advances(u64 index); // Prefix sums of character advances, filled by the caller
+        void invalidate(const REDasm::ListingItem* item); // Thread safe
+        void invalidate();                                // Thread safe
+
+    private:
+        void erase(u64 index);
+
+    private:
+        CachedLines m_lines;
+        std::unordered_map<u64, CachedLines::iterator> m_index;
+        std::unordered_map<const REDasm::ListingItem*, u64> m_revisions;
+        std::atomic<u64> m_generation;
+        std::mutex m_mutex;
+        size_t m_capacity;
+};
+
+#endif // RENDERERLINECACHE_H
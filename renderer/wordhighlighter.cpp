@@ -0,0 +1,51 @@
+#include "wordhighlighter.h"
+#include <cstring>
+
+const std::string &WordHighlighter::word() const { return m_word; }
+bool WordHighlighter::empty() const { return m_word.empty(); }
+void WordHighlighter::setWord(const std::string &word) { m_word = word; }
+const WordHighlighter::Spans &WordHighlighter::spans(size_t idx) const { return m_batch[idx]; }
+
+void WordHighlighter::find(const std::string &s, Spans &spans) const
+{
+    spans.clear();
+
+    if(m_word.empty() || (s.size() < m_word.size()))
+        return;
+
+    const char *begin = s.data(), *end = begin + s.size();
+
+    for(const char* p = this->search(begin, end); p; p = this->search(p + m_word.size(), end))
+        spans.push_back({ static_cast<size_t>(p - begin), m_word.size() });
+}
+
+void WordHighlighter::findAll(const std::vector<const REDasm::RendererLine *> &lines)
+{
+    if(m_batch.size() < lines.size())
+        m_batch.resize(lines.size());
+
+    for(size_t i = 0; i < lines.size(); i++)
+        this->find(lines[i]->text, m_batch[i]);
+}
+
+const char *WordHighlighter::search(const char *p, const char *end) const
+{
+    size_t len = m_word.size();
+    const char* word = m_word.data();
+
+    while((end - p) >= static_cast<ptrdiff_t>(len))
+    {
+        // Jump to the next candidate with memchr(), then compare the rest of the word
+        p = static_cast<const char*>(std::memchr(p, word[0], (end - p) - len + 1));
+
+        if(!p)
+            return nullptr;
+
+        if(!std::memcmp(p + 1, word + 1, len - 1))
+            return p;
+
+        p++;
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,31 @@
+#ifndef WORDHIGHLIGHTER_H
+#define WORDHIGHLIGHTER_H
+
+#include <string>
+#include <vector>
+#include <redasm/disassembler/listing/listingrenderer.h>
+
+class WordHighlighter
+{
+    public:
+        struct Span { size_t start, length; };
+        typedef std::vector<Span> Spans;
+
+    public:
+        WordHighlighter() = default;
+        const std::string& word() const;
+        bool empty() const;
+        void setWord(const std::string& word);
+        void find(const std::string& s, Spans& spans) const;
+        void findAll(const std::vector<const REDasm::RendererLine*>& lines); // Batch search for a whole render pass
+        const Spans& spans(size_t idx) const;
+
+    private:
+        const char* search(const char* p, const char* end) const;
+
+    private:
+        std::string m_word;
+        std::vector<Spans> m_batch; // Keeps its capacity between passes
+};
+
+#endif // WORDHIGHLIGHTER_H
@@ -0,0 +1,48 @@
+#include "dirtylinecoalescer.h"
+#include <algorithm>
+#include <limits>
+
+#define RANGE_LINE_MAX    0xFFFFFFFFull
+#define EMPTY_RANGE (RANGE_LINE_MAX << 32)
+
+DirtyLineCoalescer::DirtyLineCoalescer(): m_range(EMPTY_RANGE), m_coalesced(0) { }
+bool DirtyLineCoalescer::markLine(u64 line) { return this->mark(line, line); }
+bool DirtyLineCoalescer::markFrom(u64 line) { return this->mark(line, RANGE_LINE_MAX); } // Following lines are shifted
+u64 DirtyLineCoalescer::coalesced() const { return m_coalesced.load(std::memory_order_relaxed); }
+
+bool DirtyLineCoalescer::take(u64 *first, u64 *last)
+{
+    u64 range = m_range.exchange(EMPTY_RANGE, std::memory_order_acq_rel);
+
+    if(range == EMPTY_RANGE)
+        return false;
+
+    *first = range >> 32;
+    *last = range & RANGE_LINE_MAX;
+
+    if(*last == RANGE_LINE_MAX)
+        *last = std::numeric_limits<u64>::max();
+
+    return true;
+}
+
+bool DirtyLineCoalescer::mark(u64 first, u64 last)
+{
+    first = std::min(first, RANGE_LINE_MAX);
+    last = std::min(last, RANGE_LINE_MAX);
+
+    u64 range = m_range.load(std::memory_order_relaxed), newrange = 0;
+
+    do
+    {
+        u64 newfirst = std::min(range >> 32, first), newlast = std::max(range & RANGE_LINE_MAX, last);
+        newrange = (newfirst << 32) | newlast;
+    }
+    while(!m_range.compare_exchange_weak(range, newrange, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+    if(range == EMPTY_RANGE) // The first change after a flush schedules the next one
+        return true;
+
+    m_coalesced.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
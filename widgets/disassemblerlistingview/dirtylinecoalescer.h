@@ -0,0 +1,23 @@
+#ifndef DIRTYLINECOALESCER_H
+#define DIRTYLINECOALESCER_H
+
+#include <atomic>
+#include <redasm/redasm.h>
+
+class DirtyLineCoalescer
+{
+    public:
+        DirtyLineCoalescer();
+        bool markLine(u64 line);
+        bool markFrom(u64 line);
+        bool take(u64* first, u64* last);
+        u64 coalesced() const;
+
+    private:
+        bool mark(u64 first, u64 last);
+
+    private:
+        std::atomic<u64> m_range, m_coalesced; // [first:32, last:32]
+};
+
+#endif // DIRTYLINECOALESCER_H
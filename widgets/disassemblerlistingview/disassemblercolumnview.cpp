@@ -1,14 +1,45 @@
 #include "disassemblercolumnview.h"
 #include "../../themeprovider.h"
 #include <QPainter>
+#include <QHash>
 
-DisassemblerColumnView::DisassemblerColumnView(QWidget *parent) : QWidget(parent), m_disassembler(NULL), m_first(-1), m_last(-1)
+#define DIRTY_ADDRESSES_MAX 1024 // Past this every function is dropped
+
+DisassemblerColumnView::DisassemblerColumnView(QWidget *parent) : QWidget(parent), m_disassembler(NULL), m_functionsdirty(false), m_first(-1), m_last(-1)
 {
     this->setBackgroundRole(QPalette::Base);
     this->setAutoFillBackground(true);
 }
 
-void DisassemblerColumnView::setDisassembler(const REDasm::DisassemblerPtr& disassembler) { m_disassembler = disassembler; }
+DisassemblerColumnView::~DisassemblerColumnView()
+{
+    if(m_disassembler)
+        EVENT_DISCONNECT(m_disassembler->document(), changed, this);
+}
+
+void DisassemblerColumnView::setDisassembler(const REDasm::DisassemblerPtr& disassembler)
+{
+    m_disassembler = disassembler;
+
+    EVENT_CONNECT(m_disassembler->document(), changed, this, [&](const REDasm::ListingDocumentChanged* ldc) {
+        if(ldc->action != REDasm::ListingDocumentChanged::Changed) // Indices are shifted
+        {
+            m_functionsdirty = true;
+            return;
+        }
+
+        // Targets and references can change without moving anything
+        if(!ldc->item->is(REDasm::ListingItem::InstructionItem) && !ldc->item->is(REDasm::ListingItem::SymbolItem))
+            return;
+
+        std::lock_guard<std::mutex> lock(m_dirtymutex);
+
+        if(m_dirtyaddresses.size() < DIRTY_ADDRESSES_MAX)
+            m_dirtyaddresses.insert(ldc->item->address);
+        else
+            m_functionsdirty = true;
+    });
+}
 
 void DisassemblerColumnView::renderArrows(u64 start, u64 count)
 {
@@ -18,66 +49,40 @@ void DisassemblerColumnView::renderArrows(u64 start, u64 count)
     m_paths.clear();
     m_done.clear();
 
+    this->invalidateFunctions();
+
     auto& document = m_disassembler->document();
+    u64 last = std::min(m_last, static_cast<u64>(document->length()) - 1);
 
-    for(u64 i = 0; i < count; i++, start++)
+    for(u64 line = start; (line <= last) && (line < document->length()); )
     {
-        if(start >= document->length())
-            break;
-
-        REDasm::ListingItem* item = document->itemAt(start);
+        REDasm::ListingItem* functionitem = document->functionStart(document->itemAt(line)->address);
 
-        if(item->is(REDasm::ListingItem::InstructionItem))
+        if(!functionitem)
         {
-            REDasm::InstructionPtr instruction = document->instruction(item->address);
-
-            if(!instruction->is(REDasm::InstructionTypes::Jump))
-                continue;
-
-            for(address_t target : m_disassembler->getTargets(instruction->address))
-            {
-                if(target == instruction->address)
-                    continue;
-
-                u64 idx = static_cast<u64>(document->instructionIndex(target));
-
-                if(idx >= document->length())
-                    continue;
-
-                this->insertPath(item, start, idx);
-            }
+            line++;
+            continue;
         }
-        else if(item->is(REDasm::ListingItem::SymbolItem))
-        {
-            const REDasm::Symbol* symbol = document->symbol(item->address);
 
-            if(!symbol || !symbol->is(REDasm::SymbolTypes::Code))
-                continue;
+        const FunctionArrows& fa = this->functionArrows(functionitem);
+        m_queryresult.clear();
+        fa.edges.query(m_first, m_last, m_queryresult);
 
-            REDasm::ReferenceVector refs = m_disassembler->getReferences(item->address);
-            u64 toidx = static_cast<u64>(document->instructionIndex(item->address));
+        // Jumps between functions are found from both sides, keep one copy
+        for(size_t idx : m_queryresult)
+        {
+            const JumpEdgeIndex::Edge& edge = fa.edges.at(idx);
+            auto pair = qMakePair(edge.startidx, edge.endidx);
 
-            if(toidx >= document->length())
+            if(m_done.contains(pair))
                 continue;
 
-            for(address_t ref : refs)
-            {
-                if(ref == item->address)
-                    continue;
-
-                u64 idx = static_cast<u64>(document->instructionIndex(ref));
-
-                if(idx >= document->length())
-                    continue;
-
-                this->insertPath(document->itemAt(idx), idx, toidx);
-            }
+            m_done.insert(pair);
+            this->insertPath(edge, fa.lanes);
         }
-    }
 
-    std::sort(m_paths.begin(), m_paths.end(), [](const ArrowPath& p1, const ArrowPath& p2) -> bool {
-        return p1.startidx < p2.startidx;
-    });
+        line = std::max(line, fa.endidx) + 1;
+    }
 
     this->update();
 }
@@ -89,11 +94,12 @@ void DisassemblerColumnView::paintEvent(QPaintEvent*)
 
     QPainter painter(this);
     QFontMetrics fm = this->fontMetrics();
-    int w = fm.width(" "), h = fm.height(), x = this->width() - (w * 2);
+    int w = fm.width(" "), h = fm.height();
 
-    for(auto it = m_paths.begin(); it != m_paths.end(); it++, x -= w)
+    for(auto it = m_paths.begin(); it != m_paths.end(); it++)
     {
         const ArrowPath& path = *it;
+        int x = qRound(this->laneX(path.lane, path.lanes, w));
         int y1 = ((path.startidx - m_first) * h) + (h / 4);
         int y2 = ((path.endidx - m_first) * h) + ((h * 3) / 4);
         int y = ((path.endidx - m_first) * h);
@@ -126,6 +132,17 @@ bool DisassemblerColumnView::isPathSelected(const DisassemblerColumnView::ArrowP
     return (line == path.startidx) || (line == path.endidx);
 }
 
+qreal DisassemblerColumnView::laneX(u32 lane, u32 lanes, int w) const
+{
+    int maxlanes = std::max(1, (this->width() / w) - 2);
+    qreal step = w;
+
+    if(lanes > static_cast<u32>(maxlanes)) // Squeeze lanes instead of stacking the deepest ones
+        step = qMax<qreal>(1, static_cast<qreal>((maxlanes - 1) * w) / (lanes - 1));
+
+    return qMax<qreal>(0, this->width() - (w * 2) - (lane * step));
+}
+
 void DisassemblerColumnView::fillArrow(QPainter* painter, int y, const QFontMetrics& fm)
 {
     int w = fm.width(" ") / 2, hl = fm.height() / 3;
@@ -140,29 +157,222 @@ void DisassemblerColumnView::fillArrow(QPainter* painter, int y, const QFontMetr
     painter->fillPath(path, painter->pen().brush());
 }
 
-void DisassemblerColumnView::insertPath(REDasm::ListingItem* fromitem, u64 fromidx, u64 toidx)
+const DisassemblerColumnView::FunctionArrows &DisassemblerColumnView::functionArrows(const REDasm::ListingItem *functionitem)
+{
+    auto it = m_functions.find(functionitem->address);
+
+    if(it == m_functions.end())
+    {
+        this->buildGroup(functionitem);
+        it = m_functions.find(functionitem->address);
+    }
+
+    return it->second;
+}
+
+void DisassemblerColumnView::buildGroup(const REDasm::ListingItem *functionitem)
+{
+    auto& document = m_disassembler->document();
+    FunctionGroup group = std::make_shared< std::vector<address_t> >();
+    std::unordered_map<address_t, std::vector<JumpEdgeIndex::Edge> > groupedges;
+    std::vector<const REDasm::ListingItem*> pending = { functionitem };
+
+    // Functions linked by jumps are allocated together, so their arrows stay apart and keep their lanes while scrolling
+    while(!pending.empty())
+    {
+        const REDasm::ListingItem* item = pending.back();
+        pending.pop_back();
+
+        if(groupedges.count(item->address))
+            continue;
+
+        this->dropGroup(item->address); // A new jump can link an already cached group
+        FunctionArrows& fa = m_functions[item->address];
+        std::vector<JumpEdgeIndex::Edge>& edges = groupedges[item->address];
+        this->collectEdges(item, &fa, edges);
+        group->push_back(item->address);
+
+        for(const JumpEdgeIndex::Edge& edge : edges)
+        {
+            bool outgoing = (edge.startidx >= fa.startidx) && (edge.startidx <= fa.endidx);
+            u64 otheridx = outgoing ? edge.endidx : edge.startidx;
+
+            if((otheridx >= fa.startidx) && (otheridx <= fa.endidx))
+                continue;
+
+            REDasm::ListingItem* otherfunction = document->functionStart(document->itemAt(otheridx)->address);
+
+            if(otherfunction && !groupedges.count(otherfunction->address))
+                pending.push_back(otherfunction);
+        }
+    }
+
+    // Jumps between functions are found from both sides, they get one lane
+    std::vector<JumpEdgeIndex::Edge> alledges;
+    QHash<QPair<u64, u64>, size_t> edgeindex;
+
+    for(const auto& item : groupedges)
+    {
+        for(const JumpEdgeIndex::Edge& edge : item.second)
+        {
+            auto pair = qMakePair(edge.startidx, edge.endidx);
+
+            if(edgeindex.contains(pair))
+                continue;
+
+            edgeindex[pair] = alledges.size();
+            alledges.push_back(edge);
+        }
+    }
+
+    u32 lanes = JumpLaneAllocator::allocate(alledges);
+
+    for(auto& item : groupedges)
+    {
+        for(JumpEdgeIndex::Edge& edge : item.second)
+            edge.lane = alledges[edgeindex[qMakePair(edge.startidx, edge.endidx)]].lane;
+
+        FunctionArrows& fa = m_functions[item.first];
+        fa.lanes = lanes;
+        fa.group = group;
+        fa.edges.build(item.second);
+    }
+}
+
+void DisassemblerColumnView::collectEdges(const REDasm::ListingItem *functionitem, FunctionArrows *fa, std::vector<JumpEdgeIndex::Edge> &edges)
 {
     auto& document = m_disassembler->document();
-    auto pair = qMakePair(fromidx, toidx);
-    REDasm::InstructionPtr frominstruction = document->instruction(fromitem->address);
+    u64 startidx = static_cast<u64>(document->functionIndex(functionitem->address)), idx = startidx;
+
+    // Collect jumps from this function and jumps landing on its labels
+    for( ; idx < document->length(); idx++)
+    {
+        REDasm::ListingItem* item = document->itemAt(idx);
+
+        if((idx > startidx) && item->is(REDasm::ListingItem::FunctionItem))
+            break;
+
+        if(item->is(REDasm::ListingItem::InstructionItem))
+        {
+            REDasm::InstructionPtr instruction = document->instruction(item->address);
+
+            if(!instruction->is(REDasm::InstructionTypes::Jump))
+                continue;
+
+            for(address_t target : m_disassembler->getTargets(instruction->address))
+            {
+                if(target == instruction->address)
+                    continue;
+
+                u64 toidx = static_cast<u64>(document->instructionIndex(target));
+
+                if(toidx >= document->length())
+                    continue;
+
+                this->insertEdge(edges, item, idx, toidx);
+            }
+        }
+        else if(item->is(REDasm::ListingItem::SymbolItem))
+        {
+            const REDasm::Symbol* symbol = document->symbol(item->address);
 
-    if(!frominstruction || !frominstruction->is(REDasm::InstructionTypes::Jump) || m_done.contains(pair))
+            if(!symbol || !symbol->is(REDasm::SymbolTypes::Code))
+                continue;
+
+            REDasm::ReferenceVector refs = m_disassembler->getReferences(item->address);
+            u64 toidx = static_cast<u64>(document->instructionIndex(item->address));
+
+            if(toidx >= document->length())
+                continue;
+
+            for(address_t ref : refs)
+            {
+                if(ref == item->address)
+                    continue;
+
+                u64 fromidx = static_cast<u64>(document->instructionIndex(ref));
+
+                if(fromidx >= document->length())
+                    continue;
+
+                this->insertEdge(edges, document->itemAt(fromidx), fromidx, toidx);
+            }
+        }
+    }
+
+    fa->startidx = startidx;
+    fa->endidx = idx - 1;
+}
+
+void DisassemblerColumnView::dropGroup(address_t address)
+{
+    auto it = m_functions.find(address);
+
+    if(it == m_functions.end())
         return;
 
-    m_done.insert(pair);
+    FunctionGroup group = it->second.group; // Owned by the entries being erased
+
+    if(!group)
+    {
+        m_functions.erase(it);
+        return;
+    }
+
+    for(address_t functionaddress : *group)
+        m_functions.erase(functionaddress);
+}
+
+void DisassemblerColumnView::invalidateFunctions()
+{
+    std::unordered_set<address_t> dirtyaddresses;
 
-    if(fromidx > toidx) // Loop
     {
-        if(frominstruction->is(REDasm::InstructionTypes::Conditional))
-            m_paths.append({ fromidx, toidx, THEME_VALUE("graph_edge_loop_c") });
+        std::lock_guard<std::mutex> lock(m_dirtymutex);
+        dirtyaddresses.swap(m_dirtyaddresses);
+    }
+
+    if(m_functionsdirty.exchange(false))
+    {
+        m_functions.clear();
+        return;
+    }
+
+    auto& document = m_disassembler->document();
+
+    for(address_t address : dirtyaddresses)
+    {
+        REDasm::ListingItem* functionitem = document->functionStart(address);
+
+        if(functionitem)
+            this->dropGroup(functionitem->address);
+    }
+}
+
+void DisassemblerColumnView::insertEdge(std::vector<JumpEdgeIndex::Edge>& edges, REDasm::ListingItem* fromitem, u64 fromidx, u64 toidx)
+{
+    REDasm::InstructionPtr frominstruction = m_disassembler->document()->instruction(fromitem->address);
+
+    if(!frominstruction || !frominstruction->is(REDasm::InstructionTypes::Jump))
+        return;
+
+    edges.push_back({ fromidx, toidx, 0, frominstruction->is(REDasm::InstructionTypes::Conditional) });
+}
+
+void DisassemblerColumnView::insertPath(const JumpEdgeIndex::Edge& edge, u32 lanes)
+{
+    if(edge.startidx > edge.endidx) // Loop
+    {
+        if(edge.conditional)
+            m_paths.append({ edge.startidx, edge.endidx, edge.lane, lanes, THEME_VALUE("graph_edge_loop_c") });
         else
-            m_paths.append({ fromidx, toidx, THEME_VALUE("graph_edge_loop") });
+            m_paths.append({ edge.startidx, edge.endidx, edge.lane, lanes, THEME_VALUE("graph_edge_loop") });
 
         return;
     }
 
-    if(frominstruction->is(REDasm::InstructionTypes::Conditional))
-        m_paths.append({ fromidx, toidx, THEME_VALUE("graph_edge_false") });
+    if(edge.conditional)
+        m_paths.append({ edge.startidx, edge.endidx, edge.lane, lanes, THEME_VALUE("graph_edge_false") });
     else
-        m_paths.append({ fromidx, toidx, THEME_VALUE("graph_edge") });
+        m_paths.append({ edge.startidx, edge.endidx, edge.lane, lanes, THEME_VALUE("graph_edge") });
 }
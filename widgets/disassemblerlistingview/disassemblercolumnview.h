@@ -5,18 +5,27 @@
 #include <QList>
 #include <QPair>
 #include <QSet>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <atomic>
 #include <redasm/disassembler/disassemblerapi.h>
 #include <redasm/disassembler/listing/listingdocument.h>
+#include "jumplaneallocator.h"
 
 class DisassemblerColumnView : public QWidget
 {
     Q_OBJECT
 
     private:
-        struct ArrowPath{ u64 startidx, endidx; QColor color; };
+        struct ArrowPath{ u64 startidx, endidx; u32 lane, lanes; QColor color; };
+        typedef std::shared_ptr< std::vector<address_t> > FunctionGroup; // Functions linked by jumps, they share the same lanes
+        struct FunctionArrows { u64 startidx, endidx; u32 lanes; JumpEdgeIndex edges; FunctionGroup group; };
 
     public:
         explicit DisassemblerColumnView(QWidget *parent = nullptr);
+        virtual ~DisassemblerColumnView();
         void setDisassembler(const REDasm::DisassemblerPtr &disassembler);
         void renderArrows(u64 start, u64 count);
 
@@ -26,10 +35,22 @@ class DisassemblerColumnView : public QWidget
     private:
         bool isPathSelected(const ArrowPath& path) const;
         void fillArrow(QPainter* painter, int y, const QFontMetrics &fm);
-        void insertPath(REDasm::ListingItem *fromitem, u64 fromidx, u64 toidx);
+        const FunctionArrows& functionArrows(const REDasm::ListingItem* functionitem);
+        void buildGroup(const REDasm::ListingItem* functionitem);
+        void collectEdges(const REDasm::ListingItem* functionitem, FunctionArrows* fa, std::vector<JumpEdgeIndex::Edge>& edges);
+        void dropGroup(address_t address);
+        void invalidateFunctions();
+        void insertEdge(std::vector<JumpEdgeIndex::Edge>& edges, REDasm::ListingItem *fromitem, u64 fromidx, u64 toidx);
+        void insertPath(const JumpEdgeIndex::Edge& edge, u32 lanes);
+        qreal laneX(u32 lane, u32 lanes, int w) const;
 
     private:
         REDasm::DisassemblerPtr m_disassembler;
+        std::unordered_map<address_t, FunctionArrows> m_functions;
+        std::unordered_set<address_t> m_dirtyaddresses; // Changed items, their functions are dropped before the next render
+        std::atomic<bool> m_functionsdirty;
+        std::mutex m_dirtymutex;
+        std::vector<size_t> m_queryresult;
         QList<ArrowPath> m_paths;
         QSet< QPair<u64, u64> > m_done;
         u64 m_first, m_last;
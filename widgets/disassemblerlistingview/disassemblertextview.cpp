@@ -10,7 +10,7 @@
 #define DOCUMENT_IDEAL_SIZE   10
 #define DOCUMENT_WHEEL_LINES  3
 
-DisassemblerTextView::DisassemblerTextView(QWidget *parent): QAbstractScrollArea(parent), m_disassembler(NULL), m_disassemblerpopup(NULL), m_refreshtimerid(-1)
+DisassemblerTextView::DisassemblerTextView(QWidget *parent): QAbstractScrollArea(parent), m_disassembler(NULL), m_disassemblerpopup(NULL), m_refreshtimerid(-1), m_flushtimerid(-1)
 {
     QFont font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
     font.setStyleHint(QFont::TypeWriter);
@@ -62,6 +62,12 @@ DisassemblerTextView::~DisassemblerTextView()
         this->killTimer(m_refreshtimerid);
         m_refreshtimerid = -1;
     }
+
+    if(m_flushtimerid != -1)
+    {
+        this->killTimer(m_flushtimerid);
+        m_flushtimerid = -1;
+    }
 }
 
 bool DisassemblerTextView::canGoBack() const { return this->currentDocument()->cursor()->canGoBack(); }
@@ -80,18 +86,18 @@ u64 DisassemblerTextView::visibleLines() const
 
 u64 DisassemblerTextView::firstVisibleLine() const { return this->verticalScrollBar()->value(); }
 u64 DisassemblerTextView::lastVisibleLine() const { return this->firstVisibleLine() + this->visibleLines() - 1; }
+u64 DisassemblerTextView::coalescedChanges() const { return m_dirtylines.coalesced(); }
 
 void DisassemblerTextView::setDisassembler(const REDasm::DisassemblerPtr& disassembler)
 {
     m_disassembler = disassembler;
+    m_renderer = std::make_unique<ListingTextRenderer>(this->font(), m_disassembler.get());
 
     EVENT_CONNECT(this->currentDocument(), changed, this, std::bind(&DisassemblerTextView::onDocumentChanged, this, std::placeholders::_1));
     EVENT_CONNECT(this->currentDocument()->cursor(), positionChanged, this, std::bind(&DisassemblerTextView::moveToSelection, this));
 
     this->adjustScrollBars();
-    connect(this->verticalScrollBar(), &QScrollBar::valueChanged, this, [&](int) { this->renderListing(); });
 
-    m_renderer = std::make_unique<ListingTextRenderer>(this->font(), m_disassembler.get());
     m_disassemblerpopup = new DisassemblerPopup(m_disassembler, this);
 
     if(!m_disassembler->busy())
@@ -161,6 +167,8 @@ void DisassemblerTextView::goForward() { this->currentDocument()->cursor()->goFo
 
 void DisassemblerTextView::renderListing(const QRect &r)
 {
+    this->invalidateBackbuffer(r);
+
     if(!m_disassembler || (m_disassembler->busy() && (m_refreshtimerid != -1)))
         return;
 
@@ -210,27 +218,46 @@ void DisassemblerTextView::scrollContentsBy(int dx, int dy)
         return;
     }
 
-    QAbstractScrollArea::scrollContentsBy(dx, dy);
+    if(!this->canBlit(dy))
+    {
+        this->renderListing();
+        return;
+    }
+
+    // Reuse the retained lines and render only the exposed ones
+    QRect vprect = this->viewport()->rect();
+    int lineheight = this->fontMetrics().height();
+    m_backbuffer.scroll(0, dy * qRound(lineheight * m_backbuffer.devicePixelRatioF()), m_backbuffer.rect());
+
+    if(dy > 0) // Scroll Up
+        m_dirtyregion += QRect(0, 0, vprect.width(), dy * lineheight);
+    else // Scroll Down: the last line can be partially visible, render it again too
+        m_dirtyregion += QRect(0, vprect.height() - ((-dy + 1) * lineheight), vprect.width(), (-dy + 1) * lineheight);
+
+    this->viewport()->update();
 }
 
 void DisassemblerTextView::paintEvent(QPaintEvent *e)
 {
-    Q_UNUSED(e)
-
     if(!m_disassembler || !m_renderer)
         return;
 
-    QFontMetrics fm = this->fontMetrics();
-    const QRect& r = e->rect();
+    QWidget* viewport = this->viewport();
+    qreal dpr = viewport->devicePixelRatioF();
 
-    u64 firstvisible = this->firstVisibleLine();
-    u64 first = firstvisible + (r.top() / fm.height());
-    u64 last = firstvisible + (r.bottom() / fm.height());
+    if(m_backbuffer.isNull() || (m_backbuffer.size() != (viewport->size() * dpr)))
+    {
+        m_backbuffer = QPixmap(viewport->size() * dpr);
+        m_backbuffer.setDevicePixelRatio(dpr);
+        m_dirtyregion = viewport->rect();
+    }
 
-    QPainter painter(this->viewport());
-    painter.setFont(this->font());
-    m_renderer->setFirstVisibleLine(firstvisible);
-    this->paintLines(&painter, first, last);
+    if(!m_dirtyregion.isEmpty())
+        this->paintBackbuffer();
+
+    const QRect& r = e->rect();
+    QPainter painter(viewport);
+    painter.drawPixmap(r, m_backbuffer, QRectF(r.topLeft() * dpr, r.size() * dpr));
 }
 
 void DisassemblerTextView::resizeEvent(QResizeEvent *e)
@@ -446,6 +473,12 @@ void DisassemblerTextView::timerEvent(QTimerEvent *e)
         m_refreshtimerid = -1;
         this->renderListing();
     }
+    if(e->timerId() == m_flushtimerid)
+    {
+        this->killTimer(m_flushtimerid);
+        m_flushtimerid = -1;
+        this->flushDirtyLines();
+    }
     if(e->timerId() == m_blinktimerid)
         this->blinkCursor();
 
@@ -464,26 +497,45 @@ bool DisassemblerTextView::event(QEvent *e)
     return QAbstractScrollArea::event(e);
 }
 
+void DisassemblerTextView::paintBackbuffer()
+{
+    QFontMetrics fm = this->fontMetrics();
+    QRect r = m_dirtyregion.boundingRect();
+    m_dirtyregion = QRegion();
+
+    u64 firstvisible = this->firstVisibleLine();
+    u64 first = firstvisible + (std::max(r.top(), 0) / fm.height());
+    u64 last = firstvisible + (r.bottom() / fm.height());
+    QRect linesrect(0, (first - firstvisible) * fm.height(), this->viewport()->width(), ((last - first) + 1) * fm.height());
+
+    QPainter painter(&m_backbuffer);
+    painter.setFont(this->font());
+    painter.setClipRect(linesrect);
+    painter.fillRect(linesrect, this->viewport()->palette().color(this->viewport()->backgroundRole()));
+    m_renderer->setFirstVisibleLine(firstvisible);
+    this->paintLines(&painter, first, last);
+}
+
 void DisassemblerTextView::paintLines(QPainter *painter, u64 first, u64 last)
 {
     u64 count = (last - first) + 1;
-    m_renderer->render(first, count, painter);
+    m_renderer->renderLines(first, count, painter);
 }
 
 void DisassemblerTextView::onDocumentChanged(const REDasm::ListingDocumentChanged *ldc)
 {
+    m_renderer->invalidate(ldc);
     m_disassembler->document()->cursor()->clearSelection();
-    this->adjustScrollBars();
 
-    if(ldc->action != REDasm::ListingDocumentChanged::Changed) // Insertion or Deletion
-    {
-        if(ldc->index > this->lastVisibleLine()) // Don't care of bottom Insertion/Deletion
-            return;
+    bool schedule = false;
 
-        QMetaObject::invokeMethod(this, "renderListing", Qt::QueuedConnection);
-    }
+    if(ldc->action != REDasm::ListingDocumentChanged::Changed) // Insertion or Deletion
+        schedule = m_dirtylines.markFrom(ldc->index);
     else
-        QMetaObject::invokeMethod(this, "renderLine", Qt::QueuedConnection, Q_ARG(u64, ldc->index));
+        schedule = m_dirtylines.markLine(ldc->index);
+
+    if(schedule) // Changes are merged until the pending flush runs
+        QMetaObject::invokeMethod(this, "flushDirtyLines", Qt::QueuedConnection);
 }
 
 REDasm::ListingDocument &DisassemblerTextView::currentDocument() { return m_disassembler->document(); }
@@ -562,11 +614,53 @@ void DisassemblerTextView::renderLine(u64 line)
     this->paintLines(line, line);
 }
 
+void DisassemblerTextView::flushDirtyLines()
+{
+    qint64 elapsed = m_lastflush.isValid() ? m_lastflush.elapsed() : m_refreshrate;
+
+    if(elapsed < m_refreshrate) // Flush at most once per frame
+    {
+        if(m_flushtimerid == -1)
+            m_flushtimerid = this->startTimer(m_refreshrate - elapsed);
+
+        return;
+    }
+
+    u64 first = 0, last = 0;
+
+    if(!m_dirtylines.take(&first, &last))
+        return;
+
+    m_lastflush.start();
+    this->adjustScrollBars();
+    this->paintLines(first, last);
+}
+
+void DisassemblerTextView::invalidateBackbuffer(const QRect &r)
+{
+    if(r.isNull())
+        m_dirtyregion = this->viewport()->rect();
+    else
+        m_dirtyregion += r;
+}
+
+bool DisassemblerTextView::canBlit(int dy) const
+{
+    if(m_backbuffer.isNull() || !m_dirtyregion.isEmpty() || (static_cast<u64>(std::abs(dy)) >= this->visibleLines()))
+        return false;
+
+    qreal lineheight = this->fontMetrics().height() * m_backbuffer.devicePixelRatioF();
+    return qFuzzyCompare(lineheight, std::round(lineheight)); // Retained lines must be aligned to physical pixels
+}
+
 void DisassemblerTextView::paintLines(u64 first, u64 last)
 {
     first = std::max(first, this->firstVisibleLine());
     last = std::min(last, this->lastVisibleLine());
 
+    if(first > last)
+        return;
+
     QRect firstrect = this->lineRect(first);
     QRect lastrect = this->lineRect(last);
 
@@ -2,10 +2,12 @@
 #define DISASSEMBLERTEXTVIEW_H
 
 #include <QAbstractScrollArea>
+#include <QElapsedTimer>
 #include <QFontMetrics>
 #include <QMenu>
 #include "../../renderer/listingtextrenderer.h"
 #include "../disassemblerpopup/disassemblerpopup.h"
+#include "dirtylinecoalescer.h"
 
 class DisassemblerTextView : public QAbstractScrollArea
 {
@@ -19,6 +21,7 @@ class DisassemblerTextView : public QAbstractScrollArea
         u64 visibleLines() const;
         u64 firstVisibleLine() const;
         u64 lastVisibleLine() const;
+        u64 coalescedChanges() const;
         void setDisassembler(const REDasm::DisassemblerPtr &disassembler);
 
     public slots:
@@ -31,6 +34,7 @@ class DisassemblerTextView : public QAbstractScrollArea
         void goForward();
         void renderListing(const QRect& r = QRect());
         void renderLine(u64 line);
+        void flushDirtyLines();
         void showReferencesUnderCursor();
         void renameCurrentSymbol();
         bool followUnderCursor();
@@ -64,6 +68,9 @@ class DisassemblerTextView : public QAbstractScrollArea
         bool isLineVisible(u64 line) const;
         bool isColumnVisible(u64 column, u64 *xpos);
         QRect lineRect(u64 line);
+        void paintBackbuffer();
+        void invalidateBackbuffer(const QRect& r = QRect());
+        bool canBlit(int dy) const;
         void paintLines(u64 first, u64 last);
         void blinkCursor();
         void adjustScrollBars();
@@ -94,7 +101,11 @@ class DisassemblerTextView : public QAbstractScrollArea
         QAction *m_actgoto, *m_acthexdumpshow, *m_acthexdumpfunc;
         QAction *m_actcomment, *m_actback, *m_actforward, *m_actcopy;
         QMenu* m_contextmenu;
-        int m_refreshrate, m_blinktimerid, m_refreshtimerid;
+        QPixmap m_backbuffer;
+        QRegion m_dirtyregion;
+        DirtyLineCoalescer m_dirtylines;
+        QElapsedTimer m_lastflush;
+        int m_refreshrate, m_blinktimerid, m_refreshtimerid, m_flushtimerid;
 };
 
 #endif // DISASSEMBLERTEXTVIEW_H
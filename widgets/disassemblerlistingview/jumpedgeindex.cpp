@@ -0,0 +1,105 @@
+#include "jumpedgeindex.h"
+#include <algorithm>
+
+#define LINEAR_SCAN_LEVEL 3 // Small subtrees are scanned linearly
+
+JumpEdgeIndex::JumpEdgeIndex(): m_maxlevel(-1) { }
+bool JumpEdgeIndex::empty() const { return m_nodes.empty(); }
+size_t JumpEdgeIndex::size() const { return m_nodes.size(); }
+const JumpEdgeIndex::Edge &JumpEdgeIndex::at(size_t idx) const { return m_nodes[idx].edge; }
+
+void JumpEdgeIndex::build(const std::vector<Edge> &edges)
+{
+    m_nodes.clear();
+    m_nodes.reserve(edges.size());
+    m_maxlevel = -1;
+
+    for(const Edge& edge : edges)
+    {
+        u64 lo = std::min(edge.startidx, edge.endidx), hi = std::max(edge.startidx, edge.endidx) + 1;
+        m_nodes.push_back({ lo, hi, hi, edge });
+    }
+
+    if(m_nodes.empty())
+        return;
+
+    std::sort(m_nodes.begin(), m_nodes.end(), [](const Node& n1, const Node& n2) { return n1.lo < n2.lo; });
+
+    // Nodes are laid out as a complete binary tree in order: leaves at even indices,
+    // level k nodes at indices with k trailing ones. Each node keeps the max end of its subtree
+    size_t n = m_nodes.size(), lastidx = 0;
+    u64 lastmax = 0;
+
+    for(size_t i = 0; i < n; i += 2)
+    {
+        lastidx = i;
+        lastmax = m_nodes[i].maxhi = m_nodes[i].hi;
+    }
+
+    int k = 1;
+
+    for( ; (static_cast<size_t>(1) << k) <= n; k++)
+    {
+        size_t x = static_cast<size_t>(1) << (k - 1), i0 = (x << 1) - 1, step = x << 2;
+
+        for(size_t i = i0; i < n; i += step)
+        {
+            u64 el = m_nodes[i - x].maxhi;
+            u64 er = ((i + x) < n) ? m_nodes[i + x].maxhi : lastmax;
+            m_nodes[i].maxhi = std::max(m_nodes[i].hi, std::max(el, er));
+        }
+
+        lastidx = ((lastidx >> k) & 1) ? (lastidx - x) : (lastidx + x);
+
+        if((lastidx < n) && (m_nodes[lastidx].maxhi > lastmax))
+            lastmax = m_nodes[lastidx].maxhi;
+    }
+
+    m_maxlevel = k - 1;
+}
+
+void JumpEdgeIndex::query(u64 first, u64 last, std::vector<size_t> &result) const
+{
+    struct StackItem { int k; size_t x; bool visited; };
+
+    if(m_nodes.empty())
+        return;
+
+    u64 st = first, en = last + 1;
+    size_t n = m_nodes.size();
+    StackItem stack[64];
+    int t = 0;
+
+    stack[t++] = { m_maxlevel, (static_cast<size_t>(1) << m_maxlevel) - 1, false };
+
+    while(t)
+    {
+        StackItem z = stack[--t];
+
+        if(z.k <= LINEAR_SCAN_LEVEL)
+        {
+            size_t i0 = (z.x >> z.k) << z.k, i1 = std::min(i0 + (static_cast<size_t>(1) << (z.k + 1)) - 1, n);
+
+            for(size_t i = i0; (i < i1) && (m_nodes[i].lo < en); i++)
+            {
+                if(st < m_nodes[i].hi)
+                    result.push_back(i);
+            }
+        }
+        else if(!z.visited) // Left child first
+        {
+            size_t y = z.x - (static_cast<size_t>(1) << (z.k - 1));
+            stack[t++] = { z.k, z.x, true };
+
+            if((y >= n) || (m_nodes[y].maxhi > st))
+                stack[t++] = { z.k - 1, y, false };
+        }
+        else if((z.x < n) && (m_nodes[z.x].lo < en))
+        {
+            if(st < m_nodes[z.x].hi)
+                result.push_back(z.x);
+
+            stack[t++] = { z.k - 1, z.x + (static_cast<size_t>(1) << (z.k - 1)), false };
+        }
+    }
+}
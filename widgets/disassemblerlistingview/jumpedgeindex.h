@@ -0,0 +1,28 @@
+#ifndef JUMPEDGEINDEX_H
+#define JUMPEDGEINDEX_H
+
+#include <vector>
+#include <redasm/redasm.h>
+
+class JumpEdgeIndex // Implicit augmented interval tree (as in cgranges)
+{
+    public:
+        struct Edge { u64 startidx, endidx; u32 lane; bool conditional; };
+
+    private:
+        struct Node { u64 lo, hi, maxhi; Edge edge; }; // [lo, hi)
+
+    public:
+        JumpEdgeIndex();
+        bool empty() const;
+        size_t size() const;
+        const Edge& at(size_t idx) const;
+        void build(const std::vector<Edge>& edges);
+        void query(u64 first, u64 last, std::vector<size_t>& result) const;
+
+    private:
+        std::vector<Node> m_nodes;
+        int m_maxlevel;
+};
+
+#endif // JUMPEDGEINDEX_H
@@ -0,0 +1,54 @@
+#include "jumplaneallocator.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+u32 JumpLaneAllocator::allocate(std::vector<JumpEdgeIndex::Edge> &edges)
+{
+    typedef std::pair<u64, u32> LaneEnd; // Last line, lane
+
+    std::vector<size_t> order(edges.size());
+
+    for(size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+
+    // Shorter arrows first on ties, so they get the inner lanes
+    std::sort(order.begin(), order.end(), [&](size_t i1, size_t i2) {
+        const JumpEdgeIndex::Edge &e1 = edges[i1], &e2 = edges[i2];
+        u64 lo1 = std::min(e1.startidx, e1.endidx), lo2 = std::min(e2.startidx, e2.endidx);
+
+        if(lo1 != lo2)
+            return lo1 < lo2;
+
+        return std::max(e1.startidx, e1.endidx) < std::max(e2.startidx, e2.endidx);
+    });
+
+    // Greedy interval graph colouring: reuse the lowest lane whose arrow has already ended
+    std::priority_queue<LaneEnd, std::vector<LaneEnd>, std::greater<LaneEnd> > busy;
+    std::priority_queue<u32, std::vector<u32>, std::greater<u32> > freelanes;
+    u32 lanes = 0;
+
+    for(size_t i : order)
+    {
+        JumpEdgeIndex::Edge& edge = edges[i];
+        u64 lo = std::min(edge.startidx, edge.endidx), hi = std::max(edge.startidx, edge.endidx);
+
+        while(!busy.empty() && (busy.top().first < lo))
+        {
+            freelanes.push(busy.top().second);
+            busy.pop();
+        }
+
+        if(freelanes.empty())
+            edge.lane = lanes++;
+        else
+        {
+            edge.lane = freelanes.top();
+            freelanes.pop();
+        }
+
+        busy.push({ hi, edge.lane });
+    }
+
+    return lanes;
+}
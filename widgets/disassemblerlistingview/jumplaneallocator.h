@@ -0,0 +1,14 @@
+#ifndef JUMPLANEALLOCATOR_H
+#define JUMPLANEALLOCATOR_H
+
+#include <vector>
+#include "jumpedgeindex.h"
+
+class JumpLaneAllocator
+{
+    public:
+        JumpLaneAllocator() = delete;
+        static u32 allocate(std::vector<JumpEdgeIndex::Edge>& edges);
+};
+
+#endif // JUMPLANEALLOCATOR_H
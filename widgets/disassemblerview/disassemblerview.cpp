@@ -31,14 +31,17 @@ DisassemblerView::DisassemblerView(QLineEdit *lefilter, QWidget *parent) : QWidg
 
     m_importsmodel = ListingFilterModel::createFilter<SymbolTableModel>(REDasm::ListingItem::SymbolItem, ui->tvImports);
     static_cast<SymbolTableModel*>(m_importsmodel->sourceModel())->setSymbolFlags(REDasm::SymbolTypes::ImportMask);
+    static_cast<SymbolTableModel*>(m_importsmodel->sourceModel())->setDeferredPopulation(true);
     ui->tvImports->setModel(m_importsmodel);
 
     m_exportsmodel = ListingFilterModel::createFilter<SymbolTableModel>(REDasm::ListingItem::AllItems, ui->tvExports);
     static_cast<SymbolTableModel*>(m_exportsmodel->sourceModel())->setSymbolFlags(REDasm::SymbolTypes::ExportMask);
+    static_cast<SymbolTableModel*>(m_exportsmodel->sourceModel())->setDeferredPopulation(true);
     ui->tvExports->setModel(m_exportsmodel);
 
     m_stringsmodel = ListingFilterModel::createFilter<SymbolTableModel>(REDasm::ListingItem::SymbolItem, ui->tvStrings);
     static_cast<SymbolTableModel*>(m_stringsmodel->sourceModel())->setSymbolFlags(REDasm::SymbolTypes::StringMask);
+    static_cast<SymbolTableModel*>(m_stringsmodel->sourceModel())->setDeferredPopulation(true);
     ui->tvStrings->setModel(m_stringsmodel);
 
     m_segmentsmodel = ListingFilterModel::createFilter<SegmentsModel>(ui->tvSegments);
@@ -224,7 +227,13 @@ void DisassemblerView::goTo(const QModelIndex &index)
     if(!index.isValid() || !index.internalPointer())
         return;
 
-    REDasm::ListingItem* item = reinterpret_cast<REDasm::ListingItem*>(index.internalPointer());
+    REDasm::ListingItem* item = NULL;
+
+    if(index.model() == m_docks->callGraphModel())
+        item = m_docks->callGraphModel()->item(index);
+    else
+        item = reinterpret_cast<REDasm::ListingItem*>(index.internalPointer());
+
     m_listingview->textView()->goTo(item);
     this->checkSyncGraph();
 }
@@ -245,10 +254,7 @@ void DisassemblerView::showModelReferences()
     const REDasm::Symbol* symbol = nullptr;
 
     if(m_currentindex.model() == m_docks->callGraphModel())
-    {
-        REDasm::InstructionPtr instruction = m_disassembler->document()->instruction(item->address);
-        symbol = m_disassembler->document()->symbol(m_disassembler->getTarget(instruction->address));
-    }
+        symbol = m_disassembler->document()->symbol(m_docks->callGraphModel()->target(m_currentindex));
     else
         symbol = m_disassembler->document()->symbol(item->address);
 
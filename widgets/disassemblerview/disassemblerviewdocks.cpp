@@ -1,5 +1,6 @@
 #include "disassemblerviewdocks.h"
 #include <QHeaderView>
+#include <QComboBox>
 #include <QApplication>
 
 DisassemblerViewDocks::DisassemblerViewDocks(QObject *parent) : QObject(parent), m_disassembler(NULL)
@@ -74,8 +75,8 @@ void DisassemblerViewDocks::updateCallGraph()
         return;
     }
 
-    m_callgraphmodel->initializeGraph(item->address);
-    m_callgraphview->expandToDepth(0);
+    if(m_callgraphmodel->initializeGraph(item->address)) // Cursor moves inside the same function are free
+        m_callgraphview->expandToDepth(0);
 }
 
 QDockWidget *DisassemblerViewDocks::findDock(const QString &objectname) const
@@ -105,6 +106,13 @@ void DisassemblerViewDocks::createCallGraphModel()
     m_callgraphview->header()->setSectionResizeMode(2, QHeaderView::ResizeToContents);
 
     connect(m_callgraphview, &QTreeView::expanded, m_callgraphmodel, &CallGraphModel::populateCallGraph);
+
+    QComboBox* cbcallgraphmode = m_docksymbols->widget()->findChild<QComboBox*>("cbCallGraphMode");
+
+    connect(cbcallgraphmode, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, [&](int index) {
+        m_callgraphmodel->setMode(index);
+        m_callgraphview->expandToDepth(0);
+    });
 }
 
 void DisassemblerViewDocks::createFunctionsModel()
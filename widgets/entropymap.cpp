@@ -0,0 +1,92 @@
+#include "entropymap.h"
+#include <redasm/plugins/loader.h>
+#include <algorithm>
+#include <cmath>
+
+#define ENTROPY_BUCKETS        4096
+#define ENTROPY_MIN_BUCKETSIZE 256
+
+EntropyMap::EntropyMap(QObject *receiver, const REDasm::DisassemblerPtr &disassembler): QRunnable(), m_receiver(receiver), m_disassembler(disassembler), m_ready(false), m_cancelled(false), m_bucketsize(0)
+{
+    this->setAutoDelete(false);
+}
+
+bool EntropyMap::ready() const { return m_ready; }
+void EntropyMap::cancel() { m_cancelled = true; }
+u64 EntropyMap::bucketSize() const { return m_bucketsize; }
+const std::vector<EntropyMap::Bucket> &EntropyMap::buckets() const { return m_buckets; }
+
+void EntropyMap::run()
+{
+    REDasm::AbstractBuffer* buffer = m_disassembler->loader()->buffer();
+    const u8* data = reinterpret_cast<const u8*>(buffer->data());
+    u64 size = buffer->size();
+
+    if(!size)
+        return;
+
+    m_bucketsize = std::max(static_cast<u64>(ENTROPY_MIN_BUCKETSIZE), (size + ENTROPY_BUCKETS - 1) / ENTROPY_BUCKETS);
+    m_buckets.reserve((size + m_bucketsize - 1) / m_bucketsize);
+
+    for(u64 offset = 0; offset < size; offset += m_bucketsize)
+    {
+        if(m_cancelled)
+            return;
+
+        u32 counts[256];
+        u64 bucketsize = std::min(m_bucketsize, size - offset);
+        EntropyMap::histogram(data + offset, bucketsize, counts);
+        m_buckets.push_back(EntropyMap::analyze(counts, bucketsize));
+    }
+
+    m_ready = true;
+    QMetaObject::invokeMethod(m_receiver, "update", Qt::QueuedConnection);
+}
+
+void EntropyMap::histogram(const u8 *data, u64 size, u32 *counts)
+{
+    // Four interleaved tables break the dependency between consecutive equal bytes
+    u32 tables[4][256] = { };
+    u64 i = 0;
+
+    for( ; (i + 4) <= size; i += 4)
+    {
+        tables[0][data[i]]++;
+        tables[1][data[i + 1]]++;
+        tables[2][data[i + 2]]++;
+        tables[3][data[i + 3]]++;
+    }
+
+    for( ; i < size; i++)
+        tables[0][data[i]]++;
+
+    for(size_t j = 0; j < 256; j++)
+        counts[j] = tables[0][j] + tables[1][j] + tables[2][j] + tables[3][j];
+}
+
+EntropyMap::Bucket EntropyMap::analyze(const u32 *counts, u64 size)
+{
+    Bucket bucket = { 0, 0, 0, 0 };
+    u64 ascii = 0, highbit = 0;
+    double entropy = 0;
+
+    for(size_t i = 0; i < 256; i++)
+    {
+        if(!counts[i])
+            continue;
+
+        double p = static_cast<double>(counts[i]) / size;
+        entropy -= p * std::log2(p);
+
+        if(i >= 0x80)
+            highbit += counts[i];
+        else if((i >= 0x20) && (i < 0x7F))
+            ascii += counts[i];
+    }
+
+    bucket.entropy = static_cast<float>(entropy / 8); // 8 bits per byte at most
+    bucket.zero = static_cast<float>(counts[0]) / size;
+    bucket.ascii = static_cast<float>(ascii) / size;
+    bucket.highbit = static_cast<float>(highbit) / size;
+    return bucket;
+}
@@ -0,0 +1,35 @@
+#ifndef ENTROPYMAP_H
+#define ENTROPYMAP_H
+
+#include <QRunnable>
+#include <QObject>
+#include <atomic>
+#include <vector>
+#include <redasm/disassembler/disassemblerapi.h>
+
+class EntropyMap : public QRunnable
+{
+    public:
+        struct Bucket { float entropy, zero, ascii, highbit; }; // Normalized to [0, 1]
+
+    public:
+        EntropyMap(QObject* receiver, const REDasm::DisassemblerPtr& disassembler);
+        bool ready() const;
+        void cancel();
+        u64 bucketSize() const;
+        const std::vector<Bucket>& buckets() const;
+        virtual void run();
+
+    private:
+        static void histogram(const u8* data, u64 size, u32* counts);
+        static Bucket analyze(const u32* counts, u64 size);
+
+    private:
+        QObject* m_receiver;
+        REDasm::DisassemblerPtr m_disassembler;
+        std::vector<Bucket> m_buckets;
+        std::atomic<bool> m_ready, m_cancelled;
+        u64 m_bucketsize;
+};
+
+#endif // ENTROPYMAP_H
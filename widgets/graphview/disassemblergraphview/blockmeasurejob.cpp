@@ -0,0 +1,18 @@
+#include "blockmeasurejob.h"
+
+BlockMeasureJob::BlockMeasureJob(const REDasm::DisassemblerPtr &disassembler, const REDasm::Graphing::FunctionGraph *graph, const QFont &font, Block *first, Block *last, quint64 generation, const std::atomic<quint64> *currentgeneration): QRunnable(), m_disassembler(disassembler), m_graph(graph), m_font(font), m_first(first), m_last(last), m_generation(generation), m_currentgeneration(currentgeneration) { }
+
+void BlockMeasureJob::run()
+{
+    ListingGraphRenderer renderer(m_font, m_disassembler.get()); // One renderer per thread
+
+    for(Block* block = m_first; block != m_last; block++)
+    {
+        if(m_generation != *m_currentgeneration)
+            return;
+
+        const auto* fbb = m_graph->data(block->node);
+        renderer.renderLines(fbb->startidx, fbb->count(), block->lines); // Plain getRendererLine() output, no cursor state
+        block->textwidth = renderer.textWidth(block->lines); // Plain arithmetic with monospace fonts
+    }
+}
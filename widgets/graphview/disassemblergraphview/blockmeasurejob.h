@@ -0,0 +1,29 @@
+#ifndef BLOCKMEASUREJOB_H
+#define BLOCKMEASUREJOB_H
+
+#include <QRunnable>
+#include <QFont>
+#include <atomic>
+#include <vector>
+#include <redasm/graph/functiongraph.h>
+#include "../../../renderer/listinggraphrenderer.h"
+
+class BlockMeasureJob : public QRunnable
+{
+    public:
+        struct Block { REDasm::Graphing::Node node; ListingGraphRenderer::Lines lines; qreal textwidth; };
+
+    public:
+        BlockMeasureJob(const REDasm::DisassemblerPtr& disassembler, const REDasm::Graphing::FunctionGraph* graph, const QFont& font, Block* first, Block* last, quint64 generation, const std::atomic<quint64>* currentgeneration);
+        virtual void run();
+
+    private:
+        REDasm::DisassemblerPtr m_disassembler;
+        const REDasm::Graphing::FunctionGraph* m_graph;
+        QFont m_font;
+        Block *m_first, *m_last;
+        quint64 m_generation;
+        const std::atomic<quint64>* m_currentgeneration;
+};
+
+#endif // BLOCKMEASUREJOB_H
@@ -1,19 +1,15 @@
 #ifndef DISASSEMBLERBLOCKITEM_H
 #define DISASSEMBLERBLOCKITEM_H
 
-#include <QTextDocument>
 #include <redasm/graph/functiongraph.h>
 #include "../../../renderer/listinggraphrenderer.h"
 #include "../graphviewitem.h"
 
 class DisassemblerBlockItem : public GraphViewItem
 {
-    Q_OBJECT
-
     public:
-        explicit DisassemblerBlockItem(const REDasm::Graphing::FunctionBasicBlock* fbb, const REDasm::DisassemblerPtr& disassembler, QWidget *parent = nullptr);
-        virtual ~DisassemblerBlockItem();
-        bool hasIndex(s64 index) const;
+        DisassemblerBlockItem(const REDasm::Graphing::FunctionBasicBlock* fbb, REDasm::ListingCursor* cursor, ListingGraphRenderer* renderer, const ListingGraphRenderer::Lines* lines);
+        static QSize blockSize(qreal textwidth, qreal textheight);
 
     public:
         virtual void render(QPainter* painter);
@@ -21,19 +17,13 @@ class DisassemblerBlockItem : public GraphViewItem
 
     protected:
         virtual void mousePressEvent(QMouseEvent *e);
-        virtual void invalidate(bool notify = true);
-
-    private:
-        QSize documentSize() const;
-        void setupDocument();
 
     private:
         const REDasm::Graphing::FunctionBasicBlock* m_basicblock;
-        std::unique_ptr<ListingGraphRenderer> m_renderer;
-        REDasm::DisassemblerPtr m_disassembler;
-        QTextDocument m_document;
-        QFont m_font;
-        float m_charheight;
+        REDasm::ListingCursor* m_cursor;
+        ListingGraphRenderer* m_renderer;
+        const ListingGraphRenderer::Lines* m_lines; // Owned by the layout
+        qreal m_textwidth;
 };
 
 #endif // DISASSEMBLERBLOCKITEM_H
@@ -1,45 +1,69 @@
 #include "disassemblergraphview.h"
 #include "../../../models/disassemblermodel.h"
 #include "../../../redasmsettings.h"
-#include <redasm/graph/layout/layeredlayout.h>
 #include <QResizeEvent>
 #include <QScrollBar>
 #include <QPainter>
 #include <QDebug>
 #include <QAction>
+#include <algorithm>
 
-DisassemblerGraphView::DisassemblerGraphView(QWidget *parent): GraphView(parent), m_currentfunction(nullptr) { }
+#define GRAPH_CACHE_SIZE 32
 
-DisassemblerGraphView::~DisassemblerGraphView()
+DisassemblerGraphView::DisassemblerGraphView(QWidget *parent): GraphView(parent), m_currentfunction(nullptr), m_cursorblock(-1), m_layoutcache(GRAPH_CACHE_SIZE), m_cachestamp(0), m_generation(0)
 {
-    int zzz = 0;
-    zzz++;
+    qRegisterMetaType<GraphLayoutJob::LayoutPtr>("GraphLayoutJob::LayoutPtr");
+    m_pool.setMaxThreadCount(1); // Layouts are cancelled, not run concurrently
 }
 
-void DisassemblerGraphView::computeLayout()
+DisassemblerGraphView::~DisassemblerGraphView()
 {
-    for(const auto& n : this->graph()->nodes())
+    if(m_disassembler)
     {
-        const auto* fbb = static_cast<REDasm::Graphing::FunctionGraph*>(this->graph())->data(n);
-        auto* dbi = new DisassemblerBlockItem(fbb, m_disassembler, this->viewport());
-
-        m_items[n] = dbi;
-        this->graph()->width(n, dbi->width());
-        this->graph()->height(n, dbi->height());
+        EVENT_DISCONNECT(m_disassembler->document()->cursor(), positionChanged, this);
+        EVENT_DISCONNECT(m_disassembler->document(), changed, this);
     }
 
-    for(const auto& e : this->graph()->edges())
-    {
-        this->graph()->color(e, this->getEdgeColor(e).name().toStdString());
-        this->graph()->label(e, this->getEdgeLabel(e));
-    }
+    m_generation++; // Cancel pending layouts
+    m_pool.waitForDone();
+}
 
-    REDasm::Graphing::LayeredLayout ll(this->graph());
-    ll.execute();
+void DisassemblerGraphView::setDisassembler(const REDasm::DisassemblerPtr &disassembler)
+{
+    GraphView::setDisassembler(disassembler);
+
+    REDasmSettings settings;
+    QFont font = settings.currentFont();
+    font.setPointSize(settings.currentFontSize());
+
+    m_renderer = std::make_unique<ListingGraphRenderer>(font, m_disassembler.get()); // Shared by every block
+
+    EVENT_CONNECT(m_disassembler->document(), changed, this, [&](const REDasm::ListingDocumentChanged* ldc) {
+        m_layoutcache.invalidate(ldc);
+    });
+
+    // One listener for every block
+    EVENT_CONNECT(m_disassembler->document()->cursor(), positionChanged, this, [&]() {
+        QMetaObject::invokeMethod(this, "updateCursorBlock", Qt::QueuedConnection);
+    });
+}
+
+void DisassemblerGraphView::computeLayout()
+{
+    // Blocks are already measured and positioned by GraphLayoutJob
+    for(const auto& e : this->graph()->edges())
+        this->graph()->color(e, this->getEdgeColor(e).name().toStdString()); // Theme colors are resolved in GUI thread
 
     GraphView::computeLayout();
 }
 
+GraphViewItem *DisassemblerGraphView::createItem(const REDasm::Graphing::Node &n)
+{
+    const auto* fbb = static_cast<REDasm::Graphing::FunctionGraph*>(this->graph())->data(n);
+    const auto& lines = m_layout->lines;
+    return new DisassemblerBlockItem(fbb, m_disassembler->document()->cursor(), m_renderer.get(), &lines.constFind(n).value());
+}
+
 void DisassemblerGraphView::goTo(address_t address)
 {
     auto& document = m_disassembler->document();
@@ -49,16 +73,13 @@ void DisassemblerGraphView::goTo(address_t address)
 
 void DisassemblerGraphView::focusCurrentBlock()
 {
-    const REDasm::ListingCursor* cursor = m_disassembler->document()->cursor();
+    if(!this->graph())
+        return;
 
-    for(const auto& item : m_items)
-    {
-        if(!static_cast<DisassemblerBlockItem*>(item)->hasIndex(cursor->currentLine()))
-            continue;
+    int idx = this->blockAt(m_disassembler->document()->cursor()->currentLine());
 
-        this->focusBlock(item);
-        break;
-    }
+    if(idx != -1)
+        this->focusBlock(m_blocks[idx].second);
 }
 
 bool DisassemblerGraphView::renderGraph()
@@ -73,17 +94,18 @@ bool DisassemblerGraphView::renderGraph()
         return true;
 
     m_currentfunction = currentfunction;
+    GraphLayoutJob::LayoutPtr layout = m_layoutcache.find(currentfunction->address);
 
-    const REDasm::ListingItem* currentitem = document->currentItem();
-    auto graph = std::make_unique<REDasm::Graphing::FunctionGraph>(m_disassembler.get());
-
-    if(!graph->build(currentitem->address))
+    if(layout)
     {
-        REDasm::log("Graph creation failed @ " + REDasm::hex(currentitem->address));
-        return false;
+        m_generation++; // Cancel pending layouts
+        this->showLayout(layout);
+        return true;
     }
 
-    this->setGraph(graph.release());
+    m_cachestamp = m_layoutcache.stamp(); // Take it before building, changes may happen meanwhile
+    this->setPlaceholder("Computing layout...");
+    m_pool.start(new GraphLayoutJob(this, m_disassembler, currentfunction->address, m_renderer->font(), ++m_generation, &m_generation));
     return true;
 }
 
@@ -117,29 +139,86 @@ QColor DisassemblerGraphView::getEdgeColor(const REDasm::Graphing::Edge &e) cons
     return THEME_VALUE(QString::fromStdString(fbb->style(e.target)));
 }
 
-std::string DisassemblerGraphView::getEdgeLabel(const REDasm::Graphing::Edge &e) const
+void DisassemblerGraphView::layoutCompleted(quint64 generation, const GraphLayoutJob::LayoutPtr &layout)
 {
-    const REDasm::Graphing::FunctionBasicBlock* fromfbb = static_cast<const REDasm::Graphing::FunctionGraph*>(this->graph())->data(e.source);
-    const REDasm::Graphing::FunctionBasicBlock* tofbb = static_cast<const REDasm::Graphing::FunctionGraph*>(this->graph())->data(e.target);
-    REDasm::ListingDocument& document = m_disassembler->document();
-    const REDasm::ListingItem* fromitem = document->itemAt(fromfbb->endidx);
-    REDasm::InstructionPtr instruction = document->instruction(fromitem->address);
-    std::string label;
+    if(generation != m_generation) // Superseded by another function
+        return;
 
-    if(instruction && instruction->is(REDasm::InstructionTypes::Conditional))
+    if(!layout->graph)
     {
-        const REDasm::ListingItem* toitem = document->itemAt(tofbb->startidx);
+        REDasm::log("Graph creation failed @ " + REDasm::hex(layout->address));
+        m_currentfunction = nullptr;
+        this->setPlaceholder("Graph creation failed");
+        return;
+    }
+
+    m_layoutcache.insert(layout->address, m_cachestamp, layout); // m_currentfunction can be gone meanwhile
+    this->showLayout(layout);
+}
+
+void DisassemblerGraphView::showLayout(const GraphLayoutJob::LayoutPtr &layout)
+{
+    m_layout = layout; // Keeps formatted lines for blocks that are not allocated yet
+    this->setGraph(m_layout->graph);
+    this->buildBlockIndex();
 
-        if(m_disassembler->getTarget(instruction->address) == toitem->address)
-            label = "TRUE";
-        else
-            label = "FALSE";
+    if(this->isVisible())
+        this->focusCurrentBlock();
+}
+
+void DisassemblerGraphView::updateCursorBlock()
+{
+    if(!this->graph())
+        return;
+
+    const REDasm::ListingCursor* cursor = m_disassembler->document()->cursor();
+    int idx = this->blockAt(cursor->currentLine());
+
+    if(cursor->wordUnderCursor() != m_cursorword) // Highlighted words can be anywhere
+    {
+        m_cursorword = cursor->wordUnderCursor();
+        this->invalidateScene();
     }
 
-    if(tofbb->startidx <= fromfbb->startidx)
-        label += !label.empty() ? " (LOOP)" : "LOOP";
+    // Otherwise only the blocks that gain or lose the cursor need to be painted again
+    if((m_cursorblock != -1) && (m_cursorblock != idx))
+        this->invalidateItem(m_blocks[m_cursorblock].second);
+
+    if(idx != -1)
+        this->invalidateItem(m_blocks[idx].second);
+
+    m_cursorblock = idx;
+}
+
+void DisassemblerGraphView::buildBlockIndex()
+{
+    const auto* graph = static_cast<REDasm::Graphing::FunctionGraph*>(this->graph());
+    m_blocks.clear();
+
+    for(const auto& n : graph->nodes())
+        m_blocks.emplace_back(graph->data(n)->startidx, n);
+
+    std::sort(m_blocks.begin(), m_blocks.end(), [](const std::pair<s64, REDasm::Graphing::Node>& b1, const std::pair<s64, REDasm::Graphing::Node>& b2) {
+        return b1.first < b2.first;
+    });
+
+    m_cursorblock = this->blockAt(m_disassembler->document()->cursor()->currentLine());
+}
+
+int DisassemblerGraphView::blockAt(s64 line) const
+{
+    // Last block starting at or before 'line'
+    auto it = std::upper_bound(m_blocks.begin(), m_blocks.end(), line, [](s64 l, const std::pair<s64, REDasm::Graphing::Node>& b) { return l < b.first; });
+
+    if(it == m_blocks.begin())
+        return -1;
+
+    it--;
+
+    if(!static_cast<REDasm::Graphing::FunctionGraph*>(this->graph())->data(it->second)->contains(line))
+        return -1;
 
-    return label;
+    return static_cast<int>(std::distance(m_blocks.begin(), it));
 }
 
 void DisassemblerGraphView::adjustActions()
@@ -2,9 +2,13 @@
 #define DISASSEMBLERGRAPHVIEW_H
 
 #include <QAbstractScrollArea>
+#include <QThreadPool>
 #include <QList>
+#include <atomic>
 #include <redasm/graph/functiongraph.h>
 #include "disassemblerblockitem.h"
+#include "graphlayoutjob.h"
+#include "graphlayoutcache.h"
 #include "../graphview.h"
 
 class DisassemblerGraphView : public GraphView
@@ -14,21 +18,27 @@ class DisassemblerGraphView : public GraphView
     public:
         explicit DisassemblerGraphView(QWidget *parent = nullptr);
         virtual ~DisassemblerGraphView();
+        virtual void setDisassembler(const REDasm::DisassemblerPtr &disassembler);
         void goTo(address_t address);
         void focusCurrentBlock();
         bool renderGraph();
 
     protected:
         virtual QColor getEdgeColor(const REDasm::Graphing::Edge &e) const;
-        virtual std::string getEdgeLabel(const REDasm::Graphing::Edge &e) const;
         virtual void mouseReleaseEvent(QMouseEvent* e);
         virtual void keyPressEvent(QKeyEvent *e);
         virtual void showEvent(QShowEvent* e);
 
     private:
         virtual void computeLayout();
+        virtual GraphViewItem* createItem(const REDasm::Graphing::Node& n);
+        void showLayout(const GraphLayoutJob::LayoutPtr& layout);
+        void buildBlockIndex();
+        int blockAt(s64 line) const;
 
     private slots:
+        void layoutCompleted(quint64 generation, const GraphLayoutJob::LayoutPtr& layout);
+        void updateCursorBlock();
         void adjustActions();
         void showCallGraph();
         void printFunctionHexDump();
@@ -43,6 +53,15 @@ class DisassemblerGraphView : public GraphView
     private:
         QAction *m_actrename, *m_actxrefs, *m_actfollow, *m_actcallgraph, *m_acthexdump, *m_actback, *m_actforward;
         const REDasm::ListingItem* m_currentfunction;
+        std::unique_ptr<ListingGraphRenderer> m_renderer;
+        GraphLayoutJob::LayoutPtr m_layout;
+        std::vector< std::pair<s64, REDasm::Graphing::Node> > m_blocks; // Sorted by start index
+        std::string m_cursorword;
+        int m_cursorblock;
+        GraphLayoutCache m_layoutcache;
+        u64 m_cachestamp;
+        std::atomic<quint64> m_generation;
+        QThreadPool m_pool;
 };
 
 #endif // DISASSEMBLERGRAPHVIEW_H
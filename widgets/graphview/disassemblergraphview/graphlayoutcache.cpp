@@ -0,0 +1,62 @@
+#include "graphlayoutcache.h"
+
+GraphLayoutCache::GraphLayoutCache(size_t capacity): m_generation(0), m_capacity(capacity) { }
+u64 GraphLayoutCache::stamp() const { return m_generation; }
+
+GraphLayoutJob::LayoutPtr GraphLayoutCache::find(address_t address)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for(auto it = m_layouts.begin(); it != m_layouts.end(); it++)
+    {
+        if(it->address != address)
+            continue;
+
+        m_layouts.splice(m_layouts.begin(), m_layouts, it); // Most recently used
+        return m_layouts.front().layout;
+    }
+
+    return nullptr;
+}
+
+void GraphLayoutCache::insert(address_t address, u64 stamp, const GraphLayoutJob::LayoutPtr &layout)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(stamp != m_generation)
+        return;
+
+    m_layouts.remove_if([address](const CachedLayout& cl) { return cl.address == address; });
+    m_layouts.push_front({ address, layout });
+
+    if(m_layouts.size() > m_capacity)
+        m_layouts.pop_back();
+}
+
+void GraphLayoutCache::invalidate(const REDasm::ListingDocumentChanged *ldc)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_generation++;
+
+    if(!ldc->item->is(REDasm::ListingItem::InstructionItem) && !ldc->isInserted() && !ldc->isRemoved())
+    {
+        m_layouts.clear(); // Symbols can change the output of every block that references them
+        return;
+    }
+
+    address_t address = ldc->item->address;
+
+    m_layouts.remove_if([ldc, address](const CachedLayout& cl) {
+        if(ldc->isInserted() || ldc->isRemoved()) // Basic blocks store document indices, everything after 'address' is shifted
+            return cl.layout->endaddress >= address;
+
+        return (address >= cl.layout->startaddress) && (address <= cl.layout->endaddress);
+    });
+}
+
+void GraphLayoutCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_generation++;
+    m_layouts.clear();
+}
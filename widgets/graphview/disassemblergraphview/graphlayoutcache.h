@@ -0,0 +1,30 @@
+#ifndef GRAPHLAYOUTCACHE_H
+#define GRAPHLAYOUTCACHE_H
+
+#include <atomic>
+#include <mutex>
+#include <list>
+#include <redasm/disassembler/listing/listingdocument.h>
+#include "graphlayoutjob.h"
+
+class GraphLayoutCache
+{
+    private:
+        struct CachedLayout { address_t address; GraphLayoutJob::LayoutPtr layout; };
+
+    public:
+        GraphLayoutCache(size_t capacity);
+        u64 stamp() const;
+        GraphLayoutJob::LayoutPtr find(address_t address);
+        void insert(address_t address, u64 stamp, const GraphLayoutJob::LayoutPtr& layout); // Dropped if the document changed after 'stamp'
+        void invalidate(const REDasm::ListingDocumentChanged* ldc);                       // Thread safe
+        void clear();
+
+    private:
+        std::list<CachedLayout> m_layouts;
+        std::atomic<u64> m_generation;
+        std::mutex m_mutex;
+        size_t m_capacity;
+};
+
+#endif // GRAPHLAYOUTCACHE_H
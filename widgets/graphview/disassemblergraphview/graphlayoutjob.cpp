@@ -0,0 +1,116 @@
+#include "graphlayoutjob.h"
+#include "disassemblerblockitem.h"
+#include "blockmeasurejob.h"
+#include <redasm/graph/layout/layeredlayout.h>
+#include <QThreadPool>
+#include <QFontMetrics>
+#include <algorithm>
+
+#define MEASURE_MIN_CHUNK 64 // Blocks per task
+
+GraphLayoutJob::GraphLayoutJob(QObject *receiver, const REDasm::DisassemblerPtr &disassembler, address_t address, const QFont &font, quint64 generation, const std::atomic<quint64> *currentgeneration): QRunnable(), m_receiver(receiver), m_disassembler(disassembler), m_address(address), m_font(font), m_generation(generation), m_currentgeneration(currentgeneration) { }
+
+void GraphLayoutJob::run()
+{
+    if(this->cancelled())
+        return;
+
+    LayoutPtr layout = std::make_shared<Layout>();
+    layout->graph = std::make_shared<REDasm::Graphing::FunctionGraph>(m_disassembler.get());
+    layout->address = layout->startaddress = layout->endaddress = m_address;
+
+    if(!layout->graph->build(m_address))
+    {
+        layout->graph.reset(); // Reported by the receiver
+        this->publish(layout);
+        return;
+    }
+
+    if(!this->measureBlocks(layout.get()))
+        return;
+
+    for(const auto& e : layout->graph->edges())
+        layout->graph->label(e, this->edgeLabel(layout->graph.get(), e));
+
+    REDasm::Graphing::LayeredLayout ll(layout->graph.get());
+    ll.execute(); // Not interruptible, the result is discarded if the job has been cancelled meanwhile
+
+    if(!this->cancelled())
+        this->publish(layout);
+}
+
+bool GraphLayoutJob::cancelled() const { return m_generation != *m_currentgeneration; }
+
+bool GraphLayoutJob::measureBlocks(Layout *layout)
+{
+    std::vector<BlockMeasureJob::Block> blocks;
+
+    for(const auto& n : layout->graph->nodes())
+        blocks.push_back({ n, { }, 0 });
+
+    if(blocks.empty())
+        return true;
+
+    // Blocks are independent, format and measure them in parallel
+    QThreadPool pool;
+    size_t chunksize = std::max<size_t>(MEASURE_MIN_CHUNK, (blocks.size() + pool.maxThreadCount() - 1) / pool.maxThreadCount());
+
+    for(size_t i = 0; i < blocks.size(); i += chunksize)
+    {
+        pool.start(new BlockMeasureJob(m_disassembler, layout->graph.get(), m_font, blocks.data() + i,
+                                       blocks.data() + std::min(i + chunksize, blocks.size()), m_generation, m_currentgeneration));
+    }
+
+    pool.waitForDone();
+
+    if(this->cancelled())
+        return false;
+
+    qreal lineheight = QFontMetrics(m_font).height(); // Same pitch as GlyphAtlas
+    REDasm::ListingDocument& document = m_disassembler->document();
+
+    for(BlockMeasureJob::Block& block : blocks)
+    {
+        const auto* fbb = layout->graph->data(block.node);
+        layout->startaddress = std::min(layout->startaddress, document->itemAt(fbb->startidx)->address);
+        layout->endaddress = std::max(layout->endaddress, document->itemAt(fbb->endidx)->address);
+
+        QSize sz = DisassemblerBlockItem::blockSize(block.textwidth, lineheight * fbb->count());
+        layout->graph->width(block.node, sz.width());
+        layout->graph->height(block.node, sz.height());
+        layout->lines[block.node] = std::move(block.lines);
+    }
+
+    return true;
+}
+
+std::string GraphLayoutJob::edgeLabel(const REDasm::Graphing::FunctionGraph *graph, const REDasm::Graphing::Edge &e) const
+{
+    const REDasm::Graphing::FunctionBasicBlock* fromfbb = graph->data(e.source);
+    const REDasm::Graphing::FunctionBasicBlock* tofbb = graph->data(e.target);
+    REDasm::ListingDocument& document = m_disassembler->document();
+    const REDasm::ListingItem* fromitem = document->itemAt(fromfbb->endidx);
+    REDasm::InstructionPtr instruction = document->instruction(fromitem->address);
+    std::string label;
+
+    if(instruction && instruction->is(REDasm::InstructionTypes::Conditional))
+    {
+        const REDasm::ListingItem* toitem = document->itemAt(tofbb->startidx);
+
+        if(m_disassembler->getTarget(instruction->address) == toitem->address)
+            label = "TRUE";
+        else
+            label = "FALSE";
+    }
+
+    if(tofbb->startidx <= fromfbb->startidx)
+        label += !label.empty() ? " (LOOP)" : "LOOP";
+
+    return label;
+}
+
+void GraphLayoutJob::publish(const LayoutPtr &layout)
+{
+    QMetaObject::invokeMethod(m_receiver, "layoutCompleted", Qt::QueuedConnection,
+                              Q_ARG(quint64, m_generation), Q_ARG(GraphLayoutJob::LayoutPtr, layout));
+}
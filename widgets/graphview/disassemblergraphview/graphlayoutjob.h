@@ -0,0 +1,47 @@
+#ifndef GRAPHLAYOUTJOB_H
+#define GRAPHLAYOUTJOB_H
+
+#include <QRunnable>
+#include <QMetaType>
+#include <QObject>
+#include <QHash>
+#include <QFont>
+#include <atomic>
+#include <memory>
+#include <redasm/graph/functiongraph.h>
+#include "../../../renderer/listinggraphrenderer.h"
+
+class GraphLayoutJob : public QRunnable
+{
+    public:
+        struct Layout {
+            std::shared_ptr<REDasm::Graphing::FunctionGraph> graph;
+            QHash<REDasm::Graphing::Node, ListingGraphRenderer::Lines> lines;
+            address_t address;                  // Function start, the cache key
+            address_t startaddress, endaddress; // Span of the function's basic blocks
+        };
+
+        typedef std::shared_ptr<Layout> LayoutPtr;
+
+    public:
+        GraphLayoutJob(QObject* receiver, const REDasm::DisassemblerPtr& disassembler, address_t address, const QFont& font, quint64 generation, const std::atomic<quint64>* currentgeneration);
+        virtual void run();
+
+    private:
+        bool cancelled() const;
+        bool measureBlocks(Layout* layout);
+        std::string edgeLabel(const REDasm::Graphing::FunctionGraph* graph, const REDasm::Graphing::Edge& e) const;
+        void publish(const LayoutPtr& layout);
+
+    private:
+        QObject* m_receiver;
+        REDasm::DisassemblerPtr m_disassembler;
+        address_t m_address;
+        QFont m_font;
+        quint64 m_generation;
+        const std::atomic<quint64>* m_currentgeneration;
+};
+
+Q_DECLARE_METATYPE(GraphLayoutJob::LayoutPtr)
+
+#endif // GRAPHLAYOUTJOB_H
@@ -2,8 +2,20 @@
 #include <QMouseEvent>
 #include <QScrollBar>
 #include <QPainter>
-
-GraphView::GraphView(QWidget *parent): QAbstractScrollArea(parent), m_disassembler(NULL)
+#include <unordered_map>
+#include <cstring>
+#include <tuple>
+#include <cmath>
+#include <map>
+
+#define LOD_TEXT_SCALE 0.35 // Below this scale blocks are painted from thumbnails
+#define LOD_BOX_SCALE  0.12 // Below this scale blocks are plain boxes
+#define EDGE_MARGIN    4    // Covers pen width and arrowheads
+#define EDGE_BATCH_SIZE 1024 // Edges starting in the same region share a batch
+#define TILE_SIZE       256  // In device independent pixels
+#define TILE_CACHE_SIZE (64 * 1024) // KB
+
+GraphView::GraphView(QWidget *parent): QAbstractScrollArea(parent), m_disassembler(NULL), m_tiles(TILE_CACHE_SIZE), m_tiledpr(1.0)
 {
     m_prevscalefactor = m_scaledirection = 0;
     m_scalemax = 5.0;
@@ -22,23 +34,30 @@ GraphView::GraphView(QWidget *parent): QAbstractScrollArea(parent), m_disassembl
 
 void GraphView::setDisassembler(const REDasm::DisassemblerPtr& disassembler) { m_disassembler = disassembler; }
 
-void GraphView::setGraph(REDasm::Graphing::Graph *graph)
+void GraphView::setGraph(const std::shared_ptr<REDasm::Graphing::Graph> &graph)
 {
     m_scalefactor = m_scaleboost = 1.0;
-    qDeleteAll(m_items);
-    m_items.clear();
-    m_lines.clear();
+    m_placeholder.clear();
+    this->clearGraph();
 
-    m_graph = std::unique_ptr<REDasm::Graphing::Graph>(graph);
+    m_graph = graph;
     this->computeLayout();
 }
 
+void GraphView::setPlaceholder(const QString &s)
+{
+    m_placeholder = s;
+    this->clearGraph();
+    this->viewport()->update();
+}
+
 REDasm::Graphing::Graph *GraphView::graph() const { return m_graph.get(); }
 
-void GraphView::focusBlock(const GraphViewItem *item)
+void GraphView::focusBlock(const REDasm::Graphing::Node &n)
 {
-    int x = item->x() + m_renderoffset.x() + (item->width() / 2);
-    int y = item->y() + m_renderoffset.y() + (item->height() / 2);
+    QRect r = this->nodeRect(n);
+    int x = r.x() + m_renderoffset.x() + (r.width() / 2);
+    int y = r.y() + m_renderoffset.y() + (r.height() / 2);
     this->horizontalScrollBar()->setValue(x - (this->width() / 2));
     this->verticalScrollBar()->setValue(y - (this->height() / 2));
 }
@@ -120,35 +139,37 @@ void GraphView::resizeEvent(QResizeEvent *e) { this->adjustSize(e->size().width(
 
 void GraphView::paintEvent(QPaintEvent *e)
 {
-    QPoint translation = { m_renderoffset.x() - this->horizontalScrollBar()->value(),
-                           m_renderoffset.y() - this->verticalScrollBar()->value() };
-
     QPainter painter(this->viewport());
-    painter.setRenderHint(QPainter::Antialiasing);
-    painter.translate(translation);
-    painter.scale(m_scalefactor, m_scalefactor);
-    painter.save();
 
-    for(auto it = m_lines.begin(); it != m_lines.end(); it++)
+    if(!m_placeholder.isEmpty())
     {
-        QColor c(QString::fromStdString(m_graph->color(it->first)));
-        painter.setPen(QPen(c, 2.0));
-        painter.setBrush(c);
-        painter.drawLines(it->second);
-        painter.drawConvexPolygon(m_arrows[it->first]);
+        painter.drawText(this->viewport()->rect(), Qt::AlignCenter, m_placeholder);
+        return;
     }
 
-    painter.restore();
+    if(!m_graph)
+        return;
 
-    QRect vpr(this->viewport()->rect().topLeft(), this->viewport()->rect().bottomRight() - QPoint(1, 1));
-    vpr.translate(-translation.x(), -translation.y());
+    qreal dpr = this->viewport()->devicePixelRatioF();
 
-    for(auto* item : m_items)
+    if(!qFuzzyCompare(dpr, m_tiledpr)) // Screen changed
     {
-        if(!vpr.intersects(item->rect())) // Ignore blocks that are not in view
-            continue;
+        m_tiles.clear();
+        m_tiledpr = dpr;
+    }
 
-        item->render(&painter);
+    QPoint translation = { m_renderoffset.x() - this->horizontalScrollBar()->value(),
+                           m_renderoffset.y() - this->verticalScrollBar()->value() };
+
+    // Compose cached tiles, panning doesn't depend on graph complexity
+    QRect r = e->rect().translated(-translation);
+    int tx1 = std::floor(static_cast<double>(r.left()) / TILE_SIZE), tx2 = std::floor(static_cast<double>(r.right()) / TILE_SIZE);
+    int ty1 = std::floor(static_cast<double>(r.top()) / TILE_SIZE), ty2 = std::floor(static_cast<double>(r.bottom()) / TILE_SIZE);
+
+    for(int ty = ty1; ty <= ty2; ty++)
+    {
+        for(int tx = tx1; tx <= tx2; tx++)
+            painter.drawPixmap(QPoint(tx * TILE_SIZE, ty * TILE_SIZE) + translation, this->tile(tx, ty));
     }
 }
 
@@ -162,17 +183,8 @@ void GraphView::showEvent(QShowEvent *e)
 
 void GraphView::computeLayout()
 {
-    for(const auto& n : m_graph->nodes())
-    {
-        m_items[n]->move(QPoint(m_graph->x(n), m_graph->y(n)));
-        connect(m_items[n], &GraphViewItem::invalidated, this->viewport(), [&]() { this->viewport()->update(); });
-    }
-
-    for(const auto& e : m_graph->edges())
-    {
-        this->precomputeLine(e);
-        this->precomputeArrow(e);
-    }
+    this->buildEdgeBatches();
+    this->buildGrids();
 
     QSize areasize;
 
@@ -189,7 +201,44 @@ void GraphView::computeLayout()
     this->viewport()->update();
 }
 
-GraphViewItem *GraphView::itemFromMouseEvent(QMouseEvent *e) const
+GraphViewItem *GraphView::item(const REDasm::Graphing::Node &n)
+{
+    auto it = m_items.find(n);
+
+    if(it != m_items.end())
+        return it.value();
+
+    GraphViewItem* item = this->createItem(n); // Blocks are allocated the first time they are needed
+    item->move(QPoint(m_graph->x(n), m_graph->y(n)));
+
+    m_items[n] = item;
+    return item;
+}
+
+void GraphView::invalidateItem(const REDasm::Graphing::Node &n)
+{
+    auto it = m_items.find(n);
+
+    if(it != m_items.end())
+        it.value()->invalidate();
+
+    QRect r = this->nodeRect(n);
+    this->invalidateTiles(r.adjusted(-EDGE_MARGIN, -EDGE_MARGIN, EDGE_MARGIN, EDGE_MARGIN));
+    this->viewport()->update(this->viewportRect(r));
+}
+
+void GraphView::invalidateScene()
+{
+    for(GraphViewItem* item : m_items) // Thumbnails are painted from the same content
+        item->invalidate();
+
+    m_tiles.clear();
+    this->viewport()->update();
+}
+
+QRect GraphView::nodeRect(const REDasm::Graphing::Node &n) const { return QRect(m_graph->x(n), m_graph->y(n), m_graph->width(n), m_graph->height(n)); }
+
+GraphViewItem *GraphView::itemFromMouseEvent(QMouseEvent *e)
 {
     //Convert coordinates to system used in blocks
     int xofs = this->horizontalScrollBar()->value();
@@ -198,11 +247,17 @@ GraphViewItem *GraphView::itemFromMouseEvent(QMouseEvent *e) const
     QPoint pos = { static_cast<int>(std::floor((e->x() + xofs - m_renderoffset.x()) / m_scalefactor)),
                    static_cast<int>(std::floor((e->y() + yofs - m_renderoffset.y()) / m_scalefactor)) };
 
-    for(GraphViewItem* item : m_items)
+    std::vector<int> candidates;
+    m_itemgrid.query(pos, candidates);
+
+    for(int idx : candidates)
     {
-        if(!item->contains(pos))
+        const REDasm::Graphing::Node& n = m_gridnodes[idx];
+
+        if(!this->nodeRect(n).contains(pos))
             continue;
 
+        GraphViewItem* item = this->item(n);
         e->setLocalPos(item->mapToItem(pos));
         return item;
     }
@@ -246,6 +301,9 @@ void GraphView::zoomIn(const QPoint &cursorpos)
 
 void GraphView::adjustSize(int vpw, int vph, const QPoint &cursorpos, bool fit)
 {
+    if(!m_graph) // Layout in progress
+        return;
+
     m_rendersize = QSize(m_graph->areaWidth() * m_scalefactor, m_graph->areaHeight() * m_scalefactor);
     m_renderoffset = QPoint(vpw, vph);
 
@@ -283,7 +341,7 @@ void GraphView::adjustSize(int vpw, int vph, const QPoint &cursorpos, bool fit)
     }
 }
 
-void GraphView::precomputeArrow(const REDasm::Graphing::Edge &e)
+QPolygon GraphView::precomputeArrow(const REDasm::Graphing::Edge &e) const
 {
     const REDasm::Graphing::Polyline& path = m_graph->arrow(e);
     QPolygon arrowhead;
@@ -294,10 +352,10 @@ void GraphView::precomputeArrow(const REDasm::Graphing::Edge &e)
         arrowhead << QPoint(p1.x, p1.y);
     }
 
-    m_arrows[e] = arrowhead;
+    return arrowhead;
 }
 
-void GraphView::precomputeLine(const REDasm::Graphing::Edge &e)
+QVector<QLine> GraphView::precomputeLine(const REDasm::Graphing::Edge &e) const
 {
     const REDasm::Graphing::Polyline& path = m_graph->routes(e);
 
@@ -310,5 +368,182 @@ void GraphView::precomputeLine(const REDasm::Graphing::Edge &e)
         lines.push_back(QLine(p1.x, p1.y, p2.x, p2.y));
     }
 
-    m_lines[e] = lines;
+    return lines;
+}
+
+void GraphView::buildEdgeBatches()
+{
+    // One batch per color and region: a few draw calls per frame, still culled
+    std::map<std::tuple<QRgb, int, int>, size_t> batchindex;
+    std::unordered_map<std::string, QColor> colors;
+    m_edgebatches.clear();
+
+    for(const auto& e : m_graph->edges())
+    {
+        QVector<QLine> lines = this->precomputeLine(e);
+        QPolygon arrow = this->precomputeArrow(e);
+
+        if(lines.empty())
+            continue;
+
+        const std::string& colorname = m_graph->color(e);
+        auto cit = colors.find(colorname);
+
+        if(cit == colors.end())
+            cit = colors.emplace(colorname, QColor(QString::fromStdString(colorname))).first;
+
+        QPoint origin = lines.first().p1();
+        auto key = std::make_tuple(cit->second.rgba(), origin.x() / EDGE_BATCH_SIZE, origin.y() / EDGE_BATCH_SIZE);
+        auto bit = batchindex.find(key);
+
+        if(bit == batchindex.end())
+        {
+            bit = batchindex.emplace(key, m_edgebatches.size()).first;
+            m_edgebatches.push_back({ cit->second, QRect(), { }, { }, QPainterPath() });
+            m_edgebatches.back().arrows.setFillRule(Qt::WindingFill); // Overlapping arrowheads must not cancel out
+        }
+
+        EdgeBatch& eb = m_edgebatches[bit->second];
+
+        for(const QLine& l : lines)
+        {
+            eb.bounds |= QRect(l.p1(), l.p2()).normalized().adjusted(-EDGE_MARGIN, -EDGE_MARGIN, EDGE_MARGIN, EDGE_MARGIN);
+            eb.lines.push_back(l);
+        }
+
+        eb.spans.push_back(QLine(lines.first().p1(), lines.last().p2())); // Routes collapsed to a single segment
+        eb.bounds |= arrow.boundingRect();
+        eb.arrows.addPolygon(arrow);
+        eb.arrows.closeSubpath();
+    }
+}
+
+void GraphView::clearGraph()
+{
+    qDeleteAll(m_items);
+    m_items.clear();
+    m_tiles.clear();
+    m_edgebatches.clear();
+    m_gridnodes.clear();
+    m_itemgrid.clear();
+    m_graph.reset();
+}
+
+void GraphView::buildGrids()
+{
+    QRect bounds(0, 0, m_graph->areaWidth(), m_graph->areaHeight());
+    m_gridnodes.clear();
+
+    for(const auto& n : m_graph->nodes())
+    {
+        bounds |= this->nodeRect(n);
+        m_gridnodes.push_back(n);
+    }
+
+    m_itemgrid.reset(bounds, m_gridnodes.size());
+
+    for(int i = 0; i < m_gridnodes.size(); i++)
+        m_itemgrid.insert(this->nodeRect(m_gridnodes[i]), i);
+}
+
+QRect GraphView::viewportRect(const QRect &r) const
+{
+    // Graph coordinates to viewport coordinates, block shadows included
+    QPointF translation(m_renderoffset.x() - this->horizontalScrollBar()->value(),
+                        m_renderoffset.y() - this->verticalScrollBar()->value());
+
+    QRectF vr(QPointF(r.topLeft()) * m_scalefactor, QSizeF(r.size()) * m_scalefactor);
+    return vr.translated(translation).toAlignedRect().adjusted(-EDGE_MARGIN, -EDGE_MARGIN, EDGE_MARGIN, EDGE_MARGIN);
+}
+
+const QPixmap &GraphView::tile(int tx, int ty)
+{
+    quint64 key = GraphView::tileKey(m_scalefactor, tx, ty);
+    QPixmap* pixmap = m_tiles.object(key);
+
+    if(pixmap)
+        return *pixmap;
+
+    pixmap = new QPixmap(std::ceil(TILE_SIZE * m_tiledpr), std::ceil(TILE_SIZE * m_tiledpr));
+    pixmap->setDevicePixelRatio(m_tiledpr);
+    pixmap->fill(this->palette().color(QPalette::Base));
+
+    QRectF scenerect(QPointF(tx * TILE_SIZE, ty * TILE_SIZE) / m_scalefactor, QSizeF(TILE_SIZE, TILE_SIZE) / m_scalefactor);
+
+    QPainter painter(pixmap);
+    painter.translate(-tx * TILE_SIZE, -ty * TILE_SIZE);
+    painter.scale(m_scalefactor, m_scalefactor);
+    this->renderScene(&painter, scenerect.toAlignedRect().adjusted(-EDGE_MARGIN, -EDGE_MARGIN, EDGE_MARGIN, EDGE_MARGIN)); // Include block shadows
+    painter.end();
+
+    m_tiles.insert(key, pixmap, (pixmap->width() * pixmap->height() * 4) / 1024);
+    return *pixmap;
+}
+
+void GraphView::renderScene(QPainter *painter, const QRect &scenerect)
+{
+    bool detailed = m_scalefactor >= LOD_TEXT_SCALE;
+    painter->setRenderHint(QPainter::Antialiasing, detailed);
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, !detailed);
+    painter->save();
+
+    for(const EdgeBatch& eb : m_edgebatches)
+    {
+        if(!scenerect.intersects(eb.bounds))
+            continue;
+
+        if(detailed)
+        {
+            painter->setPen(QPen(eb.color, 2.0));
+            painter->setBrush(eb.color);
+            painter->drawLines(eb.lines);
+            painter->drawPath(eb.arrows);
+            continue;
+        }
+
+        painter->setPen(QPen(eb.color, 0)); // Cosmetic pen, arrowheads are not visible at this scale
+        painter->drawLines((m_scalefactor >= LOD_BOX_SCALE) ? eb.lines : eb.spans);
+    }
+
+    painter->restore();
+    m_itemgrid.query(scenerect, m_visible);
+
+    for(int idx : m_visible)
+    {
+        const REDasm::Graphing::Node& n = m_gridnodes[idx];
+
+        if(detailed)
+            this->item(n)->render(painter);
+        else if(m_scalefactor >= LOD_BOX_SCALE)
+            painter->drawPixmap(this->nodeRect(n), this->item(n)->thumbnail(LOD_TEXT_SCALE));
+        else // No need to allocate the block
+        {
+            QRect r = this->nodeRect(n);
+            painter->fillRect(r, this->palette().base());
+            painter->drawRect(r);
+        }
+    }
+}
+
+void GraphView::invalidateTiles(const QRect &scenerect)
+{
+    for(quint64 key : m_tiles.keys())
+    {
+        float scale;
+        quint32 scalebits = static_cast<quint32>(key >> 32);
+        std::memcpy(&scale, &scalebits, sizeof(float));
+
+        int tx = static_cast<qint16>((key >> 16) & 0xFFFF), ty = static_cast<qint16>(key & 0xFFFF);
+        QRectF tilerect(QPointF(tx * TILE_SIZE, ty * TILE_SIZE) / scale, QSizeF(TILE_SIZE, TILE_SIZE) / scale);
+
+        if(tilerect.intersects(scenerect))
+            m_tiles.remove(key);
+    }
+}
+
+quint64 GraphView::tileKey(float scale, int tx, int ty)
+{
+    quint32 scalebits;
+    std::memcpy(&scalebits, &scale, sizeof(float));
+    return (static_cast<quint64>(scalebits) << 32) | (static_cast<quint64>(static_cast<quint16>(tx)) << 16) | static_cast<quint16>(ty);
 }
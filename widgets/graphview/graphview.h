@@ -6,25 +6,37 @@
 // - https://github.com/x64dbg/x64dbg/blob/development/src/gui/Src/Gui/DisassemblerGraphView.cpp
 
 #include <QAbstractScrollArea>
+#include <QPixmap>
+#include <QCache>
+#include <QPainterPath>
 #include <QVector>
 #include <QList>
 #include <redasm/disassembler/disassemblerapi.h>
 #include <redasm/graph/graph.h>
 #include "../../../themeprovider.h"
 #include "graphviewitem.h"
+#include "graphviewgrid.h"
 
 class GraphView : public QAbstractScrollArea
 {
     Q_OBJECT
 
+    private:
+        struct EdgeBatch { QColor color; QRect bounds; QVector<QLine> lines, spans; QPainterPath arrows; };
+
     public:
         explicit GraphView(QWidget *parent = nullptr);
-        void setDisassembler(const REDasm::DisassemblerPtr &disassembler);
-        void setGraph(REDasm::Graphing::Graph* graph);
+        virtual void setDisassembler(const REDasm::DisassemblerPtr &disassembler);
+        void setGraph(const std::shared_ptr<REDasm::Graphing::Graph>& graph);
+        void setPlaceholder(const QString& s);
         REDasm::Graphing::Graph* graph() const;
 
     protected:
-        void focusBlock(const GraphViewItem* item);
+        void focusBlock(const REDasm::Graphing::Node& n);
+        GraphViewItem* item(const REDasm::Graphing::Node& n);
+        void invalidateItem(const REDasm::Graphing::Node& n);
+        void invalidateScene();
+        QRect nodeRect(const REDasm::Graphing::Node& n) const;
 
     protected:
         virtual void mousePressEvent(QMouseEvent* e);
@@ -35,23 +47,39 @@ class GraphView : public QAbstractScrollArea
         virtual void paintEvent(QPaintEvent* e);
         virtual void showEvent(QShowEvent* e);
         virtual void computeLayout();
+        virtual GraphViewItem* createItem(const REDasm::Graphing::Node& n) = 0;
 
     private:
-        GraphViewItem* itemFromMouseEvent(QMouseEvent *e) const;
+        GraphViewItem* itemFromMouseEvent(QMouseEvent *e);
         void zoomOut(const QPoint& cursorpos);
         void zoomIn(const QPoint& cursorpos);
         void adjustSize(int vpw, int vph, const QPoint& cursorpos = QPoint(), bool fit = false);
-        void precomputeArrow(const REDasm::Graphing::Edge& e);
-        void precomputeLine(const REDasm::Graphing::Edge& e);
+        QPolygon precomputeArrow(const REDasm::Graphing::Edge& e) const;
+        QVector<QLine> precomputeLine(const REDasm::Graphing::Edge& e) const;
+        void buildEdgeBatches();
+        void clearGraph();
+        void buildGrids();
+        QRect viewportRect(const QRect& r) const;
+        const QPixmap& tile(int tx, int ty);
+        void renderScene(QPainter* painter, const QRect& scenerect);
+        void invalidateTiles(const QRect& scenerect);
+
+    private:
+        static quint64 tileKey(float scale, int tx, int ty);
 
     protected:
         REDasm::DisassemblerPtr m_disassembler;
-        QHash<REDasm::Graphing::Node, GraphViewItem*> m_items;
 
     private:
-        std::unique_ptr<REDasm::Graphing::Graph> m_graph;
-        std::unordered_map< REDasm::Graphing::Edge, QVector<QLine> > m_lines;
-        std::unordered_map<REDasm::Graphing::Edge, QPolygon> m_arrows;
+        std::shared_ptr<REDasm::Graphing::Graph> m_graph; // Shared with the layout cache
+        QHash<REDasm::Graphing::Node, GraphViewItem*> m_items; // Allocated on demand
+        std::vector<EdgeBatch> m_edgebatches;
+        QVector<REDasm::Graphing::Node> m_gridnodes;
+        GraphViewGrid m_itemgrid;
+        std::vector<int> m_visible;
+        QCache<quint64, QPixmap> m_tiles; // Keyed by scale and tile position
+        qreal m_tiledpr;
+        QString m_placeholder;
         QPoint m_renderoffset, m_scrollbase;
         QSize m_rendersize;
         float m_scalefactor, m_scalestep, m_prevscalefactor;
@@ -0,0 +1,95 @@
+#include "graphviewgrid.h"
+#include <algorithm>
+#include <cmath>
+
+#define GRID_MIN_CELL_SIZE 64
+
+GraphViewGrid::GraphViewGrid(): m_mark(0), m_cellsize(GRID_MIN_CELL_SIZE), m_columns(0), m_rows(0) { }
+bool GraphViewGrid::empty() const { return m_cells.empty(); }
+
+void GraphViewGrid::clear()
+{
+    m_cells.clear();
+    m_marks.clear();
+    m_bounds = QRect();
+    m_columns = m_rows = 0;
+}
+
+void GraphViewGrid::reset(const QRect &bounds, int count)
+{
+    this->clear();
+
+    if(bounds.isEmpty())
+        return;
+
+    // Roughly one object per cell
+    double area = static_cast<double>(bounds.width()) * bounds.height();
+    m_cellsize = std::max(GRID_MIN_CELL_SIZE, static_cast<int>(std::sqrt(area / std::max(count, 1))));
+    m_bounds = bounds;
+    m_columns = (bounds.width() + m_cellsize - 1) / m_cellsize;
+    m_rows = (bounds.height() + m_cellsize - 1) / m_cellsize;
+    m_cells.resize(static_cast<size_t>(m_columns) * m_rows);
+}
+
+void GraphViewGrid::insert(const QRect &r, int id)
+{
+    int x1, y1, x2, y2;
+
+    if(!this->cells(r, &x1, &y1, &x2, &y2))
+        return;
+
+    for(int y = y1; y <= y2; y++)
+    {
+        for(int x = x1; x <= x2; x++)
+            m_cells[(y * m_columns) + x].push_back(id);
+    }
+
+    if(static_cast<size_t>(id) >= m_marks.size())
+        m_marks.resize(id + 1, 0);
+}
+
+void GraphViewGrid::query(const QRect &r, std::vector<int> &ids) const
+{
+    int x1, y1, x2, y2;
+    ids.clear();
+
+    if(!this->cells(r, &x1, &y1, &x2, &y2))
+        return;
+
+    if(!++m_mark) // Wrapped around, old marks are not reliable anymore
+    {
+        std::fill(m_marks.begin(), m_marks.end(), 0);
+        m_mark = 1;
+    }
+
+    for(int y = y1; y <= y2; y++)
+    {
+        for(int x = x1; x <= x2; x++)
+        {
+            for(int id : m_cells[(y * m_columns) + x])
+            {
+                if(m_marks[id] == m_mark)
+                    continue;
+
+                m_marks[id] = m_mark;
+                ids.push_back(id);
+            }
+        }
+    }
+}
+
+void GraphViewGrid::query(const QPoint &p, std::vector<int> &ids) const { this->query(QRect(p, QSize(1, 1)), ids); }
+
+bool GraphViewGrid::cells(const QRect &r, int *x1, int *y1, int *x2, int *y2) const
+{
+    QRect cr = r.normalized().intersected(m_bounds);
+
+    if(m_cells.empty() || cr.isEmpty())
+        return false;
+
+    *x1 = (cr.left() - m_bounds.left()) / m_cellsize;
+    *y1 = (cr.top() - m_bounds.top()) / m_cellsize;
+    *x2 = std::min((cr.right() - m_bounds.left()) / m_cellsize, m_columns - 1);
+    *y2 = std::min((cr.bottom() - m_bounds.top()) / m_cellsize, m_rows - 1);
+    return true;
+}
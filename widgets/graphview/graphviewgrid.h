@@ -0,0 +1,29 @@
+#ifndef GRAPHVIEWGRID_H
+#define GRAPHVIEWGRID_H
+
+#include <vector>
+#include <QRect>
+
+class GraphViewGrid
+{
+    public:
+        GraphViewGrid();
+        bool empty() const;
+        void clear();
+        void reset(const QRect& bounds, int count);
+        void insert(const QRect& r, int id);
+        void query(const QRect& r, std::vector<int>& ids) const; // Each id is reported once
+        void query(const QPoint& p, std::vector<int>& ids) const;
+
+    private:
+        bool cells(const QRect& r, int* x1, int* y1, int* x2, int* y2) const;
+
+    private:
+        std::vector< std::vector<int> > m_cells;
+        mutable std::vector<unsigned int> m_marks;
+        mutable unsigned int m_mark;
+        QRect m_bounds;
+        int m_cellsize, m_columns, m_rows;
+};
+
+#endif // GRAPHVIEWGRID_H
@@ -1,7 +1,8 @@
 #include "graphviewitem.h"
 #include <QDebug>
+#include <cmath>
 
-GraphViewItem::GraphViewItem(QObject *parent): QObject(parent) { }
+GraphViewItem::GraphViewItem(): m_thumbnailscale(0) { }
 int GraphViewItem::x() const { return this->position().x(); }
 int GraphViewItem::y() const { return this->position().y(); }
 int GraphViewItem::width() const { return this->size().width(); }
@@ -10,11 +11,27 @@ QRect GraphViewItem::rect() const { return QRect(m_pos, this->size());  }
 bool GraphViewItem::contains(const QPoint &p) const { return this->rect().contains(p); }
 const QPoint &GraphViewItem::position() const { return m_pos; }
 void GraphViewItem::move(const QPoint &pos) { m_pos = pos; }
-QPoint GraphViewItem::mapToItem(const QPoint &p) const { return QPoint(p.x() - m_pos.x(), p.y() - m_pos.y()); }
-void GraphViewItem::mousePressEvent(QMouseEvent* e) { }
 
-void GraphViewItem::invalidate(bool notify)
+const QPixmap &GraphViewItem::thumbnail(qreal scale)
 {
-    if(notify)
-        emit invalidated();
+    if(!m_thumbnail.isNull() && qFuzzyCompare(m_thumbnailscale, scale))
+        return m_thumbnail;
+
+    QSize sz = this->size();
+    m_thumbnail = QPixmap(std::max(1, static_cast<int>(std::ceil(sz.width() * scale))),
+                          std::max(1, static_cast<int>(std::ceil(sz.height() * scale))));
+
+    m_thumbnail.fill(Qt::transparent);
+    m_thumbnailscale = scale;
+
+    QPainter painter(&m_thumbnail);
+    painter.scale(scale, scale);
+    painter.translate(-m_pos);
+    this->render(&painter);
+    return m_thumbnail;
 }
+
+QPoint GraphViewItem::mapToItem(const QPoint &p) const { return QPoint(p.x() - m_pos.x(), p.y() - m_pos.y()); }
+void GraphViewItem::mousePressEvent(QMouseEvent* e) { }
+
+void GraphViewItem::invalidate() { m_thumbnail = QPixmap(); }
@@ -1,17 +1,15 @@
 #ifndef GRAPHVIEWITEM_H
 #define GRAPHVIEWITEM_H
 
-#include <QObject>
 #include <QMouseEvent>
 #include <QPainter>
+#include <QPixmap>
 #include <QRect>
 
-class GraphViewItem: public QObject
+class GraphViewItem // Plain data, GraphView allocates them on demand
 {
-    Q_OBJECT
-
     public:
-        explicit GraphViewItem(QObject* parent = nullptr);
+        GraphViewItem();
         virtual ~GraphViewItem() = default;
         int x() const;
         int y() const;
@@ -20,22 +18,22 @@ class GraphViewItem: public QObject
         QRect rect() const;
         bool contains(const QPoint& p) const;
         const QPoint& position() const;
+        const QPixmap& thumbnail(qreal scale);
         void move(const QPoint &pos);
 
     protected:
         virtual void mousePressEvent(QMouseEvent *e);
-        virtual void invalidate(bool notify = true);
+        virtual void invalidate();
 
     public:
         QPoint mapToItem(const QPoint& p) const;
         virtual void render(QPainter* painter) = 0;
         virtual QSize size() const = 0;
 
-    signals:
-        void invalidated();
-
     private:
         QPoint m_pos;
+        QPixmap m_thumbnail;
+        qreal m_thumbnailscale;
 
     friend class GraphView;
 };
@@ -1,15 +1,34 @@
 #include "listingmap.h"
 #include "../themeprovider.h"
+#include "../redasmsettings.h"
 #include <redasm/plugins/loader.h>
 #include <QPainter>
+#include <algorithm>
 #include <cmath>
 
 #define LISTINGMAP_SIZE 64
 
-ListingMap::ListingMap(QWidget *parent) : QWidget(parent), m_disassembler(NULL), m_orientation(Qt::Vertical), m_totalsize(0), m_lastseek(0)
+ListingMap::ListingMap(QWidget *parent) : QWidget(parent), m_disassembler(NULL), m_dirty(true), m_imagebusy(false), m_imageentropy(false), m_orientation(Qt::Vertical), m_totalsize(0), m_lastseek(0)
 {
     this->setBackgroundRole(QPalette::Base);
     this->setAutoFillBackground(true);
+    this->setContextMenuPolicy(Qt::ActionsContextMenu);
+
+    REDasmSettings settings;
+    m_actentropy = new QAction("Show Entropy", this);
+    m_actentropy->setCheckable(true);
+    m_actentropy->setChecked(settings.entropyOverlay());
+    this->addAction(m_actentropy);
+
+    connect(m_actentropy, &QAction::toggled, this, &ListingMap::toggleEntropy);
+}
+
+ListingMap::~ListingMap()
+{
+    if(m_entropymap)
+        m_entropymap->cancel();
+
+    m_pool.waitForDone();
 }
 
 void ListingMap::setDisassembler(const REDasm::DisassemblerPtr& disassembler)
@@ -22,6 +41,9 @@ void ListingMap::setDisassembler(const REDasm::DisassemblerPtr& disassembler)
     for(auto it = document->begin(); it != document->end(); it++)
         this->addItem(it->get());
 
+    if(m_actentropy->isChecked())
+        this->startEntropy();
+
     this->update();
     EVENT_CONNECT(document, changed, this, std::bind(&ListingMap::onDocumentChanged, this, std::placeholders::_1));
 
@@ -113,8 +135,28 @@ void ListingMap::addItem(const REDasm::ListingItem *item)
     if(!item->is(REDasm::ListingItem::FunctionItem))
         return;
 
-    auto it = REDasm::Listing::insertionPoint(&m_functions, item);
-    m_functions.insert(it, item);
+    const REDasm::Symbol* symbol = m_disassembler->document()->symbol(item->address);
+    offset_location offset = m_disassembler->loader()->offset(item->address);
+
+    FunctionExtent fe = { item->address, offset, 0, 0 };
+
+    if(offset.valid)
+        fe.flags |= ListingMap::ExtentValid;
+
+    if(symbol && symbol->isLocked())
+        fe.flags |= ListingMap::ExtentLocked;
+
+    std::lock_guard<std::mutex> lock(m_functionsmutex);
+    auto it = m_functions.insert(this->findExtent(item->address), fe);
+    size_t idx = std::distance(m_functions.begin(), it);
+
+    // Only this function and the previous one change size
+    this->updateExtentSize(idx);
+
+    if(idx)
+        this->updateExtentSize(idx - 1);
+
+    m_dirty = true;
 }
 
 void ListingMap::removeItem(const REDasm::ListingItem *item)
@@ -122,8 +164,106 @@ void ListingMap::removeItem(const REDasm::ListingItem *item)
     if(!item->is(REDasm::ListingItem::FunctionItem))
         return;
 
-    int idx = REDasm::Listing::indexOf(&m_functions, item);
-    m_functions.removeAt(idx);
+    std::lock_guard<std::mutex> lock(m_functionsmutex);
+    auto it = this->findExtent(item->address);
+
+    if((it == m_functions.end()) || (it->address != item->address))
+        return;
+
+    size_t idx = std::distance(m_functions.begin(), m_functions.erase(it));
+
+    if(idx)
+        this->updateExtentSize(idx - 1);
+
+    m_dirty = true;
+}
+
+void ListingMap::updateItem(const REDasm::ListingItem *item)
+{
+    if(!item->is(REDasm::ListingItem::FunctionItem))
+        return;
+
+    const REDasm::Symbol* symbol = m_disassembler->document()->symbol(item->address);
+    std::lock_guard<std::mutex> lock(m_functionsmutex);
+    auto it = this->findExtent(item->address);
+
+    if((it == m_functions.end()) || (it->address != item->address))
+        return;
+
+    u32 flags = it->flags & ~ListingMap::ExtentLocked;
+
+    if(symbol && symbol->isLocked())
+        flags |= ListingMap::ExtentLocked;
+
+    if(flags == it->flags)
+        return;
+
+    it->flags = flags;
+    m_dirty = true;
+}
+
+void ListingMap::updateExtentSize(size_t idx)
+{
+    FunctionExtent& fe = m_functions[idx];
+
+    if(idx == (m_functions.size() - 1))
+    {
+        REDasm::Segment* segment = m_disassembler->document()->segment(fe.address);
+        fe.size = segment ? (segment->endaddress - fe.address) : 0;
+    }
+    else
+        fe.size = m_functions[idx + 1].address - fe.address;
+}
+
+std::vector<ListingMap::FunctionExtent>::iterator ListingMap::findExtent(address_t address)
+{
+    return std::lower_bound(m_functions.begin(), m_functions.end(), address, [](const FunctionExtent& fe, address_t address) {
+        return fe.address < address;
+    });
+}
+
+void ListingMap::toggleEntropy(bool b)
+{
+    REDasmSettings settings;
+    settings.changeEntropyOverlay(b);
+
+    if(b && m_disassembler && !m_entropymap)
+        this->startEntropy();
+
+    m_dirty = true;
+    this->update();
+}
+
+void ListingMap::startEntropy()
+{
+    m_entropymap = std::make_unique<EntropyMap>(this, m_disassembler);
+    m_pool.start(m_entropymap.get());
+}
+
+void ListingMap::rasterize()
+{
+    qreal dpr = this->devicePixelRatioF();
+    m_image = QImage(this->size() * dpr, QImage::Format_RGB32);
+    m_image.setDevicePixelRatio(dpr);
+    m_image.fill(Qt::gray);
+    m_imagebusy = m_disassembler->busy();
+    m_dirty = false;
+
+    QPainter painter(&m_image);
+    painter.setFont(this->font());
+    painter.setPen(Qt::transparent);
+
+    this->renderSegments(&painter);
+
+    if(!m_imagebusy) // Don't render functions when disassembler is busy
+        this->renderFunctions(&painter);
+
+    m_imageentropy = m_actentropy->isChecked() && m_entropymap && m_entropymap->ready();
+
+    if(m_imageentropy)
+        this->renderEntropy(&painter);
+
+    this->drawLabels(&painter);
 }
 
 void ListingMap::renderSegments(QPainter* painter)
@@ -149,40 +289,69 @@ void ListingMap::renderSegments(QPainter* painter)
 
 void ListingMap::renderFunctions(QPainter *painter)
 {
-    const auto* loader = m_disassembler->loader();
-    auto lock = REDasm::s_lock_safe_ptr(m_disassembler->document());
     u64 fsize = (m_orientation == Qt::Horizontal ? this->height() : this->width()) / 2;
-    u64 size = 0;
+    QColor lockedcolor = THEME_VALUE("locked_fg"), functioncolor = THEME_VALUE("function_fg");
+    std::lock_guard<std::mutex> lock(m_functionsmutex);
 
-    for(int i = 0; i < m_functions.size(); i++)
+    for(const FunctionExtent& fe : m_functions)
     {
-        const REDasm::ListingItem* item = m_functions[i];
-
-        if(item == m_functions.last())
-        {
-            REDasm::Segment* segment = lock->segment(item->address);
-            size = segment->endaddress - item->address;
-        }
-        else
-            size = m_functions[i + 1]->address - item->address;
-
-        const REDasm::Symbol* symbol = lock->symbol(item->address);
-        offset_location offset = loader->offset(symbol->address);
-
-        if(!offset.valid)
+        if(!(fe.flags & ListingMap::ExtentValid))
             continue;
 
-        QRect r = this->buildRect(this->calculatePosition(offset), this->calculateSize(size));
+        QRect r = this->buildRect(this->calculatePosition(fe.offset), this->calculateSize(fe.size));
 
         if(m_orientation == Qt::Horizontal)
             r.setHeight(fsize);
         else
             r.setWidth(fsize);
 
-        if(symbol->isLocked())
-            painter->fillRect(r, THEME_VALUE("locked_fg"));
+        painter->fillRect(r, (fe.flags & ListingMap::ExtentLocked) ? lockedcolor : functioncolor);
+    }
+}
+
+void ListingMap::renderEntropy(QPainter *painter)
+{
+    const std::vector<EntropyMap::Bucket>& buckets = m_entropymap->buckets();
+    int size = (m_orientation == Qt::Horizontal) ? this->height() : this->width();
+    int itemsize = this->itemSize(), fsize = size / 2, esize = (size - fsize) / 2;
+
+    // Entropy goes from blue (low) to red (high), byte classes are mixed as red (high bit) and green (ASCII)
+    for(int p = 0; p < itemsize; p++)
+    {
+        u64 first = (static_cast<u64>(p) * m_totalsize / itemsize) / m_entropymap->bucketSize();
+        u64 last = ((static_cast<u64>(p + 1) * m_totalsize / itemsize) - 1) / m_entropymap->bucketSize();
+        last = std::min(std::max(first, last), static_cast<u64>(buckets.size() - 1));
+
+        if(first > last)
+            break;
+
+        float entropy = 0, ascii = 0, highbit = 0;
+
+        for(u64 i = first; i <= last; i++)
+        {
+            entropy = std::max(entropy, buckets[i].entropy); // Don't let packed data hide in wide buckets
+            ascii += buckets[i].ascii;
+            highbit += buckets[i].highbit;
+        }
+
+        float count = (last - first) + 1;
+        QRect r = this->buildRect(p, 1), cr = r;
+
+        if(m_orientation == Qt::Horizontal)
+        {
+            r.setTop(fsize);
+            r.setHeight(esize);
+            cr.setTop(fsize + esize);
+        }
         else
-            painter->fillRect(r, THEME_VALUE("function_fg"));
+        {
+            r.setLeft(fsize);
+            r.setWidth(esize);
+            cr.setLeft(fsize + esize);
+        }
+
+        painter->fillRect(r, QColor::fromHsvF((1 - entropy) * 0.66, 1, 1));
+        painter->fillRect(cr, QColor::fromRgbF(highbit / count, ascii / count, 0));
     }
 }
 
@@ -217,6 +386,8 @@ void ListingMap::onDocumentChanged(const REDasm::ListingDocumentChanged *ldc)
         this->addItem(ldc->item);
     else if(ldc->isRemoved())
         this->removeItem(ldc->item);
+    else
+        this->updateItem(ldc->item);
 }
 
 void ListingMap::paintEvent(QPaintEvent *)
@@ -224,18 +395,17 @@ void ListingMap::paintEvent(QPaintEvent *)
     if(!m_disassembler)
         return;
 
-    this->checkOrientation();
-
-    QPainter painter(this);
-    painter.setPen(Qt::transparent);
-    painter.fillRect(this->rect(), Qt::gray);
+    bool resized = this->checkOrientation() || (m_image.size() != (this->size() * this->devicePixelRatioF()));
 
-    this->renderSegments(&painter);
+    // Functions are painted only when the disassembler is idle
+    bool entropychanged = m_entropymap && m_entropymap->ready() && (m_actentropy->isChecked() != m_imageentropy);
 
-    if(!m_disassembler->busy()) // Don't render functions when disassembler is busy
-        this->renderFunctions(&painter);
+    if(resized || entropychanged || (!m_disassembler->busy() && (m_dirty || m_imagebusy)))
+        this->rasterize();
 
-    this->drawLabels(&painter);
+    QPainter painter(this);
+    painter.drawImage(0, 0, m_image);
+    painter.setPen(Qt::transparent);
 
     if(!m_disassembler->busy()) // Don't render seek when disassembler is busy
         this->renderSeek(&painter);
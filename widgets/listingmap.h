@@ -1,17 +1,29 @@
 #ifndef LISTINGMAP_H
 #define LISTINGMAP_H
 
+#include <QThreadPool>
+#include <QAction>
 #include <QWidget>
-#include <QList>
+#include <QImage>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <mutex>
 #include <redasm/disassembler/listing/listingdocument.h>
 #include <redasm/disassembler/disassemblerapi.h>
+#include "entropymap.h"
 
 class ListingMap : public QWidget
 {
     Q_OBJECT
 
+    private:
+        enum { ExtentValid = 1, ExtentLocked = 2 };
+        struct FunctionExtent { address_t address; offset_t offset; u64 size; u32 flags; };
+
     public:
         explicit ListingMap(QWidget *parent = 0);
+        virtual ~ListingMap();
         void setDisassembler(const REDasm::DisassemblerPtr &disassembler);
         virtual QSize sizeHint() const;
 
@@ -24,9 +36,16 @@ class ListingMap : public QWidget
         void onDocumentChanged(const REDasm::ListingDocumentChanged* ldc);
         void addItem(const REDasm::ListingItem* item);
         void removeItem(const REDasm::ListingItem* item);
+        void updateItem(const REDasm::ListingItem* item);
+        void updateExtentSize(size_t idx);
+        std::vector<FunctionExtent>::iterator findExtent(address_t address);
+        void rasterize();
+        void toggleEntropy(bool b);
+        void startEntropy();
         void drawLabels(QPainter *painter);
         void renderSegments(QPainter *painter);
         void renderFunctions(QPainter *painter);
+        void renderEntropy(QPainter *painter);
         void renderSeek(QPainter *painter);
 
     protected:
@@ -35,8 +54,16 @@ class ListingMap : public QWidget
 
     private:
         REDasm::DisassemblerPtr m_disassembler;
-        QList<const REDasm::ListingItem*> m_functions;
-        s32 m_orientation, m_totalsize;
+        std::vector<FunctionExtent> m_functions; // Sorted by address
+        std::mutex m_functionsmutex;
+        std::atomic<bool> m_dirty;
+        std::unique_ptr<EntropyMap> m_entropymap;
+        QThreadPool m_pool;
+        QAction* m_actentropy;
+        QImage m_image;
+        bool m_imagebusy, m_imageentropy;
+        s32 m_orientation;
+        u64 m_totalsize;
         u64 m_lastseek;
 };
 